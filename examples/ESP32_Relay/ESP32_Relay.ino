@@ -0,0 +1,93 @@
+/*
+ * WitAITTS ESP32 Relay Example
+ * 
+ * One device (the leader) fetches speech from Wit.ai and re-broadcasts it
+ * over UDP multicast. Every other device (peers) plays the same utterance,
+ * starting at a shared play-at time so all rooms stay in sync.
+ * 
+ * Copyright (c) 2025 Jobit Joseph, Circuit Digest
+ * 
+ * Hardware (each device):
+ * - ESP32 Dev Board (or ESP32-C3 / ESP32-S3 / Pico W)
+ * - MAX98357A I2S Amplifier or similar DAC
+ * - Speaker (4-8 ohm, 3W recommended)
+ * 
+ * Instructions:
+ * 1. Update WiFi credentials below (all devices on the same network)
+ * 2. Flash one device with RELAY_MODE = WITAI_RELAY_LEADER and a Wit.ai token
+ * 3. Flash the others with RELAY_MODE = WITAI_RELAY_PEER (token not used)
+ * 4. Type text into the leader's Serial Monitor (115200 baud)
+ * 
+ * Note: Your router must forward multicast on the WiFi network
+ * (some guest networks / AP isolation settings block it).
+ */
+
+#include <WitAITTS.h>
+
+// ==================== CONFIGURATION ====================
+// WiFi Credentials
+const char* WIFI_SSID     = "YourWiFiSSID";
+const char* WIFI_PASSWORD = "YourWiFiPassword";
+
+// Wit.ai Token (only the leader calls Wit.ai)
+const char* WIT_TOKEN = "YOUR_WIT_AI_TOKEN_HERE";
+
+// WITAI_RELAY_LEADER - fetches and re-broadcasts
+// WITAI_RELAY_PEER   - plays what the leader broadcasts
+const uint8_t RELAY_MODE = WITAI_RELAY_LEADER;
+// ========================================================
+
+WitAITTS tts;
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    
+    Serial.println("\n\n========================================");
+    Serial.println("   WitAITTS ESP32 Relay Example");
+    Serial.println("   Copyright (c) 2025 Jobit Joseph");
+    Serial.println("           Circuit Digest");
+    Serial.println("========================================\n");
+    
+    tts.setDebugLevel(DEBUG_INFO);
+    
+    if (!tts.begin(WIFI_SSID, WIFI_PASSWORD, WIT_TOKEN)) {
+        Serial.println("✗ TTS initialization failed!");
+        return;
+    }
+    
+    // Join the multicast group (default 239.255.42.42:5005)
+    if (tts.setRelayMode(RELAY_MODE)) {
+        Serial.println(RELAY_MODE == WITAI_RELAY_LEADER
+                           ? "✓ Relay leader ready - type text to announce\n"
+                           : "✓ Relay peer ready - waiting for the leader\n");
+    }
+}
+
+void loop() {
+    // IMPORTANT: Must call loop() - peers receive and play here
+    tts.loop();
+    
+    if (RELAY_MODE == WITAI_RELAY_LEADER && Serial.available()) {
+        String text = Serial.readStringUntil('\n');
+        text.trim();
+        
+        if (text.length() > 0) {
+            Serial.println("Announcing: " + text);
+            tts.speak(text);
+        }
+    }
+    
+    // Print relay statistics every 10 seconds
+    static unsigned long lastStats = 0;
+    if (millis() - lastStats > 10000) {
+        lastStats = millis();
+        WitAIRelayStats s = tts.getRelayStats();
+        Serial.println("Relay: sent=" + String(s.sent) +
+                       " recv=" + String(s.received) +
+                       " played=" + String(s.delivered) +
+                       " reordered=" + String(s.reordered) +
+                       " lost=" + String(s.lost) +
+                       " overflow=" + String(s.overflow));
+    }
+}
@@ -0,0 +1,612 @@
+/*
+ * WitAIMixer - Multi-input PCM mixer for the WitAITTS output path
+ *
+ * Copyright (c) 2025 Jobit Joseph, Circuit Digest
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "WitAIMixer.h"
+
+// ============================================================================
+// CONSTRUCTOR
+// ============================================================================
+
+WitAIMixer::WitAIMixer() : _sampleRate(44100), _outChannels(2) {
+  for (int i = 0; i < WITAI_MIXER_CHANNELS; i++) {
+    _channels[i].state.store(FREE, std::memory_order_relaxed);
+    _channels[i].gain.store(32768, std::memory_order_relaxed);
+  }
+}
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+
+void WitAIMixer::setOutputFormat(uint32_t sampleRate, uint8_t channels) {
+  if (sampleRate > 0)
+    _sampleRate = sampleRate;
+  _outChannels = (channels == 1) ? 1 : 2;
+}
+
+uint32_t WitAIMixer::getSampleRate() { return _sampleRate; }
+
+uint8_t WitAIMixer::getChannels() { return _outChannels; }
+
+// ============================================================================
+// CHANNEL CONTROL
+// ============================================================================
+
+int WitAIMixer::play(const int16_t *pcm, size_t frames, uint32_t sampleRate,
+                     uint8_t channels, float gain) {
+  if (!pcm || frames == 0)
+    return -1;
+  return _start(pcm, frames, nullptr, nullptr, sampleRate, channels, gain);
+}
+
+int WitAIMixer::play(WitAIMixerSource source, void *context,
+                     uint32_t sampleRate, uint8_t channels, float gain) {
+  if (!source)
+    return -1;
+  return _start(nullptr, 0, source, context, sampleRate, channels, gain);
+}
+
+int WitAIMixer::_start(const int16_t *pcm, size_t frames,
+                       WitAIMixerSource source, void *context,
+                       uint32_t sampleRate, uint8_t channels, float gain) {
+  if (sampleRate == 0 || channels < 1 || channels > 2)
+    return -1;
+
+  for (int i = 0; i < WITAI_MIXER_CHANNELS; i++) {
+    Channel &ch = _channels[i];
+    if (ch.state.load(std::memory_order_acquire) != FREE)
+      continue;
+
+    ch.pcm = source ? ch.sourceBuffer : pcm;
+    ch.frames = frames;
+    ch.pos = 0;
+    ch.source = source;
+    ch.context = context;
+    ch.sampleRate = sampleRate;
+    ch.channels = channels;
+    ch.gain.store(_gainQ15(gain), std::memory_order_relaxed);
+
+    // mix() fetches the first two input frames into prev/next, so a source
+    // callback only ever runs in the mixing context
+    ch.prev[0] = ch.prev[1] = 0;
+    ch.next[0] = ch.next[1] = 0;
+    ch.phase = 0x20000;
+    ch.draining = false;
+
+    // Publish: the fields above are visible to mix() before it sees ACTIVE
+    ch.state.store(ACTIVE, std::memory_order_release);
+    return i;
+  }
+  return -1;
+}
+
+void WitAIMixer::stop(int channel) {
+  if (channel < 0 || channel >= WITAI_MIXER_CHANNELS)
+    return;
+
+  // Only request the stop, mix() releases the channel when it is done with it
+  uint8_t expected = ACTIVE;
+  _channels[channel].state.compare_exchange_strong(expected, STOPPING,
+                                                   std::memory_order_acq_rel);
+}
+
+void WitAIMixer::stopAll() {
+  for (int i = 0; i < WITAI_MIXER_CHANNELS; i++) {
+    stop(i);
+  }
+}
+
+void WitAIMixer::setGain(int channel, float gain) {
+  if (channel >= 0 && channel < WITAI_MIXER_CHANNELS)
+    _channels[channel].gain.store(_gainQ15(gain), std::memory_order_relaxed);
+}
+
+bool WitAIMixer::isActive(int channel) {
+  if (channel < 0 || channel >= WITAI_MIXER_CHANNELS)
+    return false;
+  return _channels[channel].state.load(std::memory_order_acquire) == ACTIVE;
+}
+
+bool WitAIMixer::isActive() {
+  // STOPPING counts, so output stages keep calling mix() until it's released
+  for (int i = 0; i < WITAI_MIXER_CHANNELS; i++) {
+    if (_channels[i].state.load(std::memory_order_acquire) != FREE)
+      return true;
+  }
+  return false;
+}
+
+// ============================================================================
+// MIXING
+// ============================================================================
+
+void WitAIMixer::mix(int16_t *buffer, size_t frames) {
+  for (int c = 0; c < WITAI_MIXER_CHANNELS; c++) {
+    Channel &ch = _channels[c];
+    uint8_t state = ch.state.load(std::memory_order_acquire);
+    if (state == FREE)
+      continue;
+    if (state == STOPPING) {
+      ch.state.store(FREE, std::memory_order_release);
+      continue;
+    }
+
+    // Q16 input frames per output frame, recomputed so a format change on
+    // the output side takes effect mid-clip
+    uint32_t step = ((uint64_t)ch.sampleRate << 16) / _sampleRate;
+    int32_t gain = ch.gain.load(std::memory_order_relaxed);
+    int16_t *out = buffer;
+    bool ended = false;
+
+    for (size_t i = 0; i < frames && !ended; i++) {
+      while (ch.phase >= 0x10000) {
+        ch.prev[0] = ch.next[0];
+        ch.prev[1] = ch.next[1];
+        if (!_fetch(ch, ch.next)) {
+          if (ch.draining) {
+            ended = true;
+            break;
+          }
+          // Hold the last frame for one input period so it is played too
+          ch.draining = true;
+          ch.next[0] = ch.prev[0];
+          ch.next[1] = ch.prev[1];
+        }
+        ch.phase -= 0x10000;
+      }
+      if (ended)
+        break;
+
+      // Linear interpolation, then gain, both in Q15
+      int32_t frac = ch.phase >> 1;
+      int32_t left = ch.prev[0] + (((ch.next[0] - ch.prev[0]) * frac) >> 15);
+      int32_t right = ch.prev[1] + (((ch.next[1] - ch.prev[1]) * frac) >> 15);
+      left = (left * gain) >> 15;
+      right = (right * gain) >> 15;
+
+      if (_outChannels == 1) {
+        *out = _saturate(*out + ((left + right) >> 1));
+        out++;
+      } else {
+        out[0] = _saturate(out[0] + left);
+        out[1] = _saturate(out[1] + right);
+        out += 2;
+      }
+      ch.phase += step;
+    }
+
+    if (ended)
+      ch.state.store(FREE, std::memory_order_release);
+  }
+}
+
+bool WitAIMixer::_fetch(Channel &ch, int16_t *frame) {
+  if (ch.pos >= ch.frames) {
+    if (!ch.source)
+      return false;
+    ch.frames =
+        ch.source(ch.sourceBuffer, WITAI_MIXER_SOURCE_FRAMES, ch.context);
+    ch.pos = 0;
+    if (ch.frames == 0)
+      return false;
+  }
+
+  const int16_t *s = ch.pcm + ch.pos * ch.channels;
+  frame[0] = s[0];
+  frame[1] = (ch.channels == 2) ? s[1] : s[0];
+  ch.pos++;
+  return true;
+}
+
+int32_t WitAIMixer::_gainQ15(float gain) {
+  return (int32_t)(constrain(gain, 0.0f, 1.0f) * 32768.0f);
+}
+
+int16_t WitAIMixer::_saturate(int32_t sample) {
+  if (sample > 32767)
+    return 32767;
+  if (sample < -32768)
+    return -32768;
+  return (int16_t)sample;
+}
+
+// ============================================================================
+// RESAMPLER
+// ============================================================================
+
+WitAIResampler::WitAIResampler()
+    : _inRate(0), _outRate(0), _inChannels(0), _outChannels(0), _step(0x10000),
+      _phase(0x20000) {
+  _prev[0] = _prev[1] = 0;
+  _next[0] = _next[1] = 0;
+}
+
+void WitAIResampler::setFormat(uint32_t inRate, uint8_t inChannels,
+                               uint32_t outRate, uint8_t outChannels) {
+  if (inRate == 0 || outRate == 0)
+    return;
+  if (inRate == _inRate && inChannels == _inChannels && outRate == _outRate &&
+      outChannels == _outChannels)
+    return;
+
+  _inRate = inRate;
+  _inChannels = (inChannels == 1) ? 1 : 2;
+  _outRate = outRate;
+  _outChannels = (outChannels == 1) ? 1 : 2;
+  _step = ((uint64_t)_inRate << 16) / _outRate;
+
+  // Start over: the next two input frames become prev/next
+  _phase = 0x20000;
+  _prev[0] = _prev[1] = 0;
+  _next[0] = _next[1] = 0;
+}
+
+bool WitAIResampler::isPassthrough() {
+  return _inRate == _outRate && _inChannels == _outChannels;
+}
+
+size_t WitAIResampler::process(const int16_t *in, size_t inFrames,
+                               size_t &consumed, int16_t *out,
+                               size_t outFrames) {
+  consumed = 0;
+  size_t produced = 0;
+
+  while (produced < outFrames) {
+    while (_phase >= 0x10000) {
+      if (consumed >= inFrames)
+        return produced; // State is kept, the next call continues here
+      const int16_t *s = in + consumed * _inChannels;
+      _prev[0] = _next[0];
+      _prev[1] = _next[1];
+      _next[0] = s[0];
+      _next[1] = (_inChannels == 2) ? s[1] : s[0];
+      consumed++;
+      _phase -= 0x10000;
+    }
+
+    int32_t frac = _phase >> 1;
+    int32_t left = _prev[0] + (((_next[0] - _prev[0]) * frac) >> 15);
+    int32_t right = _prev[1] + (((_next[1] - _prev[1]) * frac) >> 15);
+
+    if (_outChannels == 1) {
+      out[produced] = (left + right) >> 1;
+    } else {
+      out[produced * 2] = left;
+      out[produced * 2 + 1] = right;
+    }
+    produced++;
+    _phase += _step;
+  }
+  return produced;
+}
+
+// ============================================================================
+// MP3 FRAME HEADER
+// ============================================================================
+
+bool WitAIMP3Header::parse(const uint8_t *data, size_t len,
+                           uint32_t &sampleRate, uint8_t &channels) {
+  size_t i = 0;
+
+  // Skip an ID3v2 tag (syncsafe size) if the stream starts with one
+  if (len >= 10 && data[0] == 'I' && data[1] == 'D' && data[2] == '3') {
+    i = 10 + (((uint32_t)(data[6] & 0x7F) << 21) |
+              ((uint32_t)(data[7] & 0x7F) << 14) |
+              ((uint32_t)(data[8] & 0x7F) << 7) | (data[9] & 0x7F));
+  }
+
+  for (; i + 4 <= len; i++) {
+    uint32_t rate;
+    uint8_t ch;
+    size_t frame = _frameLength(data + i, rate, ch);
+    if (frame == 0 || i + frame + 4 > len)
+      continue;
+
+    // Confirm with the next frame: same version/layer, rate and mode
+    uint32_t nextRate;
+    uint8_t nextCh;
+    const uint8_t *next = data + i + frame;
+    if (_frameLength(next, nextRate, nextCh) == 0 ||
+        (next[1] & 0xFE) != (data[i + 1] & 0xFE) || nextRate != rate ||
+        nextCh != ch)
+      continue;
+
+    sampleRate = rate;
+    channels = ch;
+    return true;
+  }
+  return false;
+}
+
+size_t WitAIMP3Header::_frameLength(const uint8_t *h, uint32_t &sampleRate,
+                                    uint8_t &channels) {
+  static const uint32_t rates[3] = {44100, 48000, 32000};
+  static const uint16_t kbpsV1[15] = {0,   32,  40,  48,  56,  64,  80, 96,
+                                      112, 128, 160, 192, 224, 256, 320};
+  static const uint16_t kbpsV2[15] = {0,  8,  16, 24,  32,  40,  48, 56,
+                                      64, 80, 96, 112, 128, 144, 160};
+
+  if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+    return 0;
+
+  uint8_t version = (h[1] >> 3) & 0x03; // 0=2.5, 1=reserved, 2=2, 3=1
+  uint8_t layer = (h[1] >> 1) & 0x03;   // 1 = Layer III
+  uint8_t bitrate = h[2] >> 4;
+  uint8_t rateIndex = (h[2] >> 2) & 0x03;
+  if (version == 1 || layer != 1 || bitrate == 0 || bitrate == 0x0F ||
+      rateIndex == 3)
+    return 0; // Free-format bitrate has no computable length either
+
+  uint8_t shift = (version == 3) ? 0 : (version == 2 ? 1 : 2);
+  sampleRate = rates[rateIndex] >> shift;
+  channels = ((h[3] >> 6) == 3) ? 1 : 2; // Mode 3 = single channel
+
+  // 1152 samples per MPEG-1 frame, 576 for MPEG-2/2.5
+  uint32_t bps = (version == 3 ? kbpsV1[bitrate] : kbpsV2[bitrate]) * 1000;
+  uint32_t samples = (version == 3) ? 144 : 72;
+  return samples * bps / sampleRate + ((h[2] >> 1) & 0x01);
+}
+
+// ============================================================================
+// SHARED OUTPUT STAGE HELPERS
+// ============================================================================
+
+// Send held output; false if the sink is full and some is still held
+template <class Sink>
+static bool _flushStage(Sink &sink, WitAIStageBuffer &out) {
+  while (out.offset < out.length) {
+    size_t n = sink.write((const uint8_t *)out.samples + out.offset,
+                          out.length - out.offset);
+    if (n == 0)
+      return false;
+    out.offset += n;
+  }
+  out.offset = out.length = 0;
+  return true;
+}
+
+// Convert (only if the output format is fixed), mix and forward to the sink.
+// Returns the input bytes consumed; their output is either sent or held.
+template <class Sink>
+static size_t _writeStage(Sink &sink, WitAIMixer &mixer,
+                          WitAIResampler &resampler, WitAIStageBuffer &out,
+                          uint8_t inChannels, uint8_t outChannels,
+                          const uint8_t *buffer, size_t size) {
+  if (!_flushStage(sink, out))
+    return 0;
+
+  bool passthrough = resampler.isPassthrough();
+  if (passthrough && !mixer.isActive())
+    return sink.write(buffer, size);
+
+  const int16_t *in = (const int16_t *)buffer;
+  size_t inFrameBytes = 2 * inChannels;
+  size_t outFrameBytes = 2 * outChannels;
+  size_t inFrames = size / inFrameBytes;
+  size_t scratchFrames = WITAI_MIXER_SCRATCH_SAMPLES / outChannels;
+
+  while (inFrames > 0) {
+    size_t used, produced;
+    if (passthrough) {
+      used = produced = min(inFrames, scratchFrames);
+      memcpy(out.samples, in, produced * outFrameBytes);
+    } else {
+      produced =
+          resampler.process(in, inFrames, used, out.samples, scratchFrames);
+    }
+    mixer.mix(out.samples, produced);
+    out.offset = 0;
+    out.length = produced * outFrameBytes;
+
+    // This input is consumed now, its output goes out here or next call
+    in += used * inChannels;
+    inFrames -= used;
+    if (!_flushStage(sink, out))
+      return size - inFrames * inFrameBytes;
+  }
+  return size;
+}
+
+// ============================================================================
+// ESP32 OUTPUT STAGE (BackgroundAudio)
+// ============================================================================
+
+#ifdef ARDUINO_ARCH_ESP32
+WitAIMixerOutput::WitAIMixerOutput(AudioOutputBase &sink, WitAIMixer &mixer)
+    : _sink(sink), _mixer(mixer) {
+  _fixedRate = 0;
+  _fixedChannels = 0;
+  _bitsPerSample = 16;
+  _out.offset = _out.length = 0;
+  memset(&_format, 0, sizeof(_format)); // Filled in as the decoder reports
+}
+
+void WitAIMixerOutput::setFixedFormat(uint32_t sampleRate, uint8_t channels) {
+  _fixedRate = sampleRate;
+  _fixedChannels = channels;
+  _applyFormat();
+}
+
+WitAIAudioFormat WitAIMixerOutput::getFormat() { return _format; }
+
+bool WitAIMixerOutput::setBuffers(size_t buffers, size_t bufferWords,
+                                  int32_t silenceSample) {
+  return _sink.setBuffers(buffers, bufferWords, silenceSample);
+}
+
+bool WitAIMixerOutput::setBitsPerSample(int bps) {
+  _bitsPerSample = bps;
+  return _sink.setBitsPerSample(bps);
+}
+
+bool WitAIMixerOutput::setStereo(bool stereo) {
+  _format.sourceChannels = stereo ? 2 : 1;
+  return _applyFormat();
+}
+
+bool WitAIMixerOutput::setFrequency(int freq) {
+  _format.sourceRate = freq;
+  return _applyFormat();
+}
+
+bool WitAIMixerOutput::_applyFormat() {
+  uint32_t rate = _fixedRate ? _fixedRate : _format.sourceRate;
+  uint8_t channels = _fixedChannels ? _fixedChannels : _format.sourceChannels;
+  bool ok = true;
+
+  // Only touch I2S when the negotiated format actually changes
+  if (rate && rate != _format.sampleRate) {
+    ok = _sink.setFrequency(rate) && ok;
+    _format.sampleRate = rate;
+  }
+  if (channels && channels != _format.channels) {
+    ok = _sink.setStereo(channels == 2) && ok;
+    _format.channels = channels;
+  }
+
+  _resampler.setFormat(_format.sourceRate, _format.sourceChannels,
+                       _format.sampleRate, _format.channels);
+  _format.resampled = !_resampler.isPassthrough();
+  _mixer.setOutputFormat(_format.sampleRate, _format.channels);
+  return ok;
+}
+
+void WitAIMixerOutput::onTransmit(void (*cb)(void *), void *cbData) {
+  _sink.onTransmit(cb, cbData);
+}
+
+bool WitAIMixerOutput::begin() { return _sink.begin(); }
+
+bool WitAIMixerOutput::end() { return _sink.end(); }
+
+bool WitAIMixerOutput::getUnderflow() { return _sink.getUnderflow(); }
+
+size_t WitAIMixerOutput::write(uint8_t s) { return _sink.write(s); }
+
+size_t WitAIMixerOutput::write(const uint8_t *buffer, size_t size) {
+  if (_bitsPerSample != 16 || _format.sampleRate == 0 || _format.channels == 0)
+    return _sink.write(buffer, size);
+  return _writeStage(_sink, _mixer, _resampler, _out,
+                     _format.sourceChannels, _format.channels, buffer, size);
+}
+
+int WitAIMixerOutput::availableForWrite() {
+  // Output still held from the last write goes out first
+  int space = _sink.availableForWrite() - (int)(_out.length - _out.offset);
+  if (space <= 0)
+    return 0;
+  if (!_format.resampled)
+    return space;
+
+  // Express free output space in decoder bytes
+  return (uint64_t)space * _format.sourceRate * _format.sourceChannels /
+         ((uint64_t)_format.sampleRate * _format.channels);
+}
+#endif
+
+// ============================================================================
+// RP2040/PICO OUTPUT STAGE (AudioTools)
+// ============================================================================
+
+#ifdef ARDUINO_ARCH_RP2040
+WitAIMixerStream::WitAIMixerStream(AudioStream &sink, WitAIMixer &mixer)
+    : _sink(sink), _mixer(mixer) {
+  _fixedRate = 0;
+  _fixedChannels = 0;
+  info = sink.audioInfo();
+  _format.sampleRate = _format.sourceRate = info.sample_rate;
+  _format.channels = _format.sourceChannels = info.channels;
+  _format.resampled = false;
+  _out.offset = _out.length = 0;
+  _mixer.setOutputFormat(_format.sampleRate, _format.channels);
+}
+
+void WitAIMixerStream::setFixedFormat(uint32_t sampleRate, uint8_t channels) {
+  _fixedRate = sampleRate;
+  _fixedChannels = channels;
+  _applyFormat();
+}
+
+WitAIAudioFormat WitAIMixerStream::getFormat() { return _format; }
+
+void WitAIMixerStream::setAudioInfo(AudioInfo newInfo) {
+  AudioStream::setAudioInfo(newInfo);
+  _format.sourceRate = newInfo.sample_rate;
+  _format.sourceChannels = newInfo.channels;
+  _applyFormat();
+}
+
+void WitAIMixerStream::_applyFormat() {
+  uint32_t rate = _fixedRate ? _fixedRate : _format.sourceRate;
+  uint8_t channels = _fixedChannels ? _fixedChannels : _format.sourceChannels;
+
+  // Reconfigure I2S only when the negotiated format actually changes
+  if (rate != _format.sampleRate || channels != _format.channels) {
+    AudioInfo out = _sink.audioInfo();
+    out.sample_rate = rate;
+    out.channels = channels;
+    _sink.setAudioInfo(out);
+    _format.sampleRate = rate;
+    _format.channels = channels;
+  }
+
+  _resampler.setFormat(_format.sourceRate, _format.sourceChannels,
+                       _format.sampleRate, _format.channels);
+  _format.resampled = !_resampler.isPassthrough();
+  _mixer.setOutputFormat(_format.sampleRate, _format.channels);
+}
+
+size_t WitAIMixerStream::write(const uint8_t *buffer, size_t size) {
+  if (info.bits_per_sample != 16)
+    return _sink.write(buffer, size);
+  return _writeStage(_sink, _mixer, _resampler, _out, info.channels,
+                     _format.channels, buffer, size);
+}
+
+int WitAIMixerStream::availableForWrite() {
+  // Output still held from the last write goes out first
+  int space = _sink.availableForWrite() - (int)(_out.length - _out.offset);
+  return max(space, 0);
+}
+
+size_t WitAIMixerStream::pump() {
+  if (!_flushStage(_sink, _out) || !_mixer.isActive())
+    return 0;
+
+  // Mix clips over silence, only as much as the I2S buffer takes right now
+  size_t frameBytes = 2 * _format.channels;
+  size_t chunk = min((size_t)max(_sink.availableForWrite(), 0),
+                     sizeof(_out.samples));
+  chunk -= chunk % frameBytes;
+  if (chunk == 0)
+    return 0;
+
+  memset(_out.samples, 0, chunk);
+  _mixer.mix(_out.samples, chunk / frameBytes);
+  _out.offset = 0;
+  _out.length = chunk;
+  _flushStage(_sink, _out);
+  return _out.length ? _out.offset : chunk;
+}
+#endif
@@ -0,0 +1,259 @@
+/*
+ * WitAIMixer - Multi-input PCM mixer for the WitAITTS output path
+ *
+ * Copyright (c) 2025 Jobit Joseph, Circuit Digest
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WITAIMIXER_H
+#define WITAIMIXER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <ESP32I2SAudio.h>
+#elif defined(ARDUINO_ARCH_RP2040)
+#include "AudioTools.h"
+#endif
+
+// ============================================================================
+// USER CONFIGURABLE PARAMETERS
+// ============================================================================
+
+#ifndef WITAI_MIXER_CHANNELS
+#define WITAI_MIXER_CHANNELS 4 // Clips/streams that can play at once
+#endif
+
+#ifndef WITAI_MIXER_SOURCE_FRAMES
+#define WITAI_MIXER_SOURCE_FRAMES 64 // Frames pulled per source callback
+#endif
+
+#ifndef WITAI_MIXER_SCRATCH_SAMPLES
+#define WITAI_MIXER_SCRATCH_SAMPLES 256 // Samples mixed per output write
+#endif
+
+// ============================================================================
+// WITAIMIXER CLASS
+// ============================================================================
+
+// Pull callback for decoded streams: fill up to `frames` interleaved frames,
+// return the number written. Returning 0 ends the channel. It is only called
+// from mix(), never from play(): on ESP32 that is BackgroundAudio's audio
+// task, not the sketch's loop(), so it must not block and must guard any
+// state it shares with the sketch.
+typedef size_t (*WitAIMixerSource)(int16_t *buffer, size_t frames,
+                                   void *context);
+
+class WitAIMixer {
+public:
+  WitAIMixer();
+
+  // Output format the mix is produced in (set by the platform output stage)
+  void setOutputFormat(uint32_t sampleRate, uint8_t channels);
+  uint32_t getSampleRate();
+  uint8_t getChannels();
+
+  // Start a channel, returns channel index or -1 if all channels are busy.
+  // PCM is 16-bit signed, 1 or 2 interleaved channels, any sample rate.
+  int play(const int16_t *pcm, size_t frames, uint32_t sampleRate,
+           uint8_t channels = 1, float gain = 1.0f);
+  int play(WitAIMixerSource source, void *context, uint32_t sampleRate,
+           uint8_t channels = 1, float gain = 1.0f);
+
+  void stop(int channel);
+  void stopAll();
+  void setGain(int channel, float gain); // 0.0-1.0
+  bool isActive(int channel);
+  bool isActive();
+
+  // Add all active channels onto an interleaved 16-bit buffer in the
+  // output format, with saturation
+  void mix(int16_t *buffer, size_t frames);
+
+private:
+  // Channel ownership between the sketch and the audio task (ESP32): play()
+  // only claims FREE channels and publishes them with a release store,
+  // stop() only requests STOPPING, and only mix() hands a channel back to
+  // FREE, so a channel is never reused while mix() is still inside it
+  enum ChannelState : uint8_t { FREE, ACTIVE, STOPPING };
+
+  struct Channel {
+    std::atomic<uint8_t> state;
+    const int16_t *pcm;
+    size_t frames;
+    size_t pos;
+    WitAIMixerSource source;
+    void *context;
+    int16_t sourceBuffer[WITAI_MIXER_SOURCE_FRAMES * 2];
+    uint32_t sampleRate;
+    uint8_t channels;
+    std::atomic<int32_t> gain; // Q15
+    uint32_t phase;            // Q16 position between prev and next
+    int16_t prev[2];
+    int16_t next[2];
+    bool draining; // Input ended, playing out the held last frame
+  };
+
+  Channel _channels[WITAI_MIXER_CHANNELS];
+  uint32_t _sampleRate;
+  uint8_t _outChannels;
+
+  int _start(const int16_t *pcm, size_t frames, WitAIMixerSource source,
+             void *context, uint32_t sampleRate, uint8_t channels, float gain);
+  bool _fetch(Channel &ch, int16_t *frame);
+  static int32_t _gainQ15(float gain);
+  static int16_t _saturate(int32_t sample);
+};
+
+// ============================================================================
+// OUTPUT FORMAT & RESAMPLER
+// ============================================================================
+
+// Format negotiated between the decoded stream and the I2S device
+struct WitAIAudioFormat {
+  uint32_t sampleRate;    // Rate the I2S device runs at
+  uint8_t channels;       // Channels the I2S device runs with
+  uint32_t sourceRate;    // Rate of the decoded stream
+  uint8_t sourceChannels; // Channels of the decoded stream
+  bool resampled;         // Converting because the output format is fixed
+};
+
+// Streaming linear resampler with mono/stereo conversion, used only when the
+// output format is fixed and differs from the decoded stream
+class WitAIResampler {
+public:
+  WitAIResampler();
+
+  void setFormat(uint32_t inRate, uint8_t inChannels, uint32_t outRate,
+                 uint8_t outChannels);
+  bool isPassthrough();
+
+  // Convert interleaved 16-bit input. Returns output frames written;
+  // `consumed` is set to the input frames used.
+  size_t process(const int16_t *in, size_t inFrames, size_t &consumed,
+                 int16_t *out, size_t outFrames);
+
+private:
+  uint32_t _inRate, _outRate;
+  uint8_t _inChannels, _outChannels;
+  uint32_t _step;  // Q16 input frames per output frame
+  uint32_t _phase; // Q16 position between prev and next
+  int16_t _prev[2];
+  int16_t _next[2];
+};
+
+// First MP3 (Layer III) frame header of a stream. A header only counts when
+// another one with the same version, rate and mode follows exactly one frame
+// later, so a stray 0xFFE sync (ID3 padding, chunked-encoding size lines)
+// can't set a wrong format.
+class WitAIMP3Header {
+public:
+  static bool parse(const uint8_t *data, size_t len, uint32_t &sampleRate,
+                    uint8_t &channels);
+
+private:
+  // Frame length in bytes, 0 if `h` is not a valid Layer III header
+  static size_t _frameLength(const uint8_t *h, uint32_t &sampleRate,
+                             uint8_t &channels);
+};
+
+// Mixed/converted output the sink has not taken yet. It is sent before any
+// new input is accepted, so rejected output is neither dropped nor re-mixed.
+struct WitAIStageBuffer {
+  int16_t samples[WITAI_MIXER_SCRATCH_SAMPLES];
+  size_t offset; // Bytes already handed to the sink
+  size_t length; // Bytes of output held
+};
+
+// ============================================================================
+// PLATFORM OUTPUT STAGES
+// ============================================================================
+
+#ifdef ARDUINO_ARCH_ESP32
+// Sits between BackgroundAudio and the I2S device, mixing active channels
+// into the decoded speech. BackgroundAudio keeps writing silence while
+// paused, so clips also play between utterances.
+class WitAIMixerOutput : public AudioOutputBase {
+public:
+  WitAIMixerOutput(AudioOutputBase &sink, WitAIMixer &mixer);
+
+  // 0 follows the decoded stream (default), otherwise convert to this format.
+  // Set it before audio starts: write() does not expect it to change.
+  void setFixedFormat(uint32_t sampleRate, uint8_t channels);
+  WitAIAudioFormat getFormat();
+
+  bool setBuffers(size_t buffers, size_t bufferWords,
+                  int32_t silenceSample = 0) override;
+  bool setBitsPerSample(int bps) override;
+  bool setStereo(bool stereo = true) override;
+  bool setFrequency(int freq) override;
+  void onTransmit(void (*cb)(void *), void *cbData) override;
+  bool begin() override;
+  bool end() override;
+  bool getUnderflow() override;
+  size_t write(uint8_t s) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int availableForWrite() override;
+
+private:
+  AudioOutputBase &_sink;
+  WitAIMixer &_mixer;
+  WitAIResampler _resampler;
+  WitAIAudioFormat _format;
+  uint32_t _fixedRate;
+  uint8_t _fixedChannels;
+  int _bitsPerSample;
+  WitAIStageBuffer _out;
+
+  bool _applyFormat();
+};
+
+#elif defined(ARDUINO_ARCH_RP2040)
+// Sits between the MP3 decoder and I2SStream, mixing active channels into
+// the decoded speech. pump() feeds clips on their own between utterances.
+class WitAIMixerStream : public AudioStream {
+public:
+  WitAIMixerStream(AudioStream &sink, WitAIMixer &mixer);
+
+  // 0 follows the decoded stream (default), otherwise convert to this format.
+  // Set it before audio starts: write() does not expect it to change.
+  void setFixedFormat(uint32_t sampleRate, uint8_t channels);
+  WitAIAudioFormat getFormat();
+
+  void setAudioInfo(AudioInfo info) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int availableForWrite() override;
+  size_t pump();
+
+private:
+  AudioStream &_sink;
+  WitAIMixer &_mixer;
+  WitAIResampler _resampler;
+  WitAIAudioFormat _format;
+  uint32_t _fixedRate;
+  uint8_t _fixedChannels;
+  WitAIStageBuffer _out;
+
+  void _applyFormat();
+};
+#endif
+
+#endif // WITAIMIXER_H
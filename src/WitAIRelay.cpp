@@ -0,0 +1,396 @@
+/*
+ * WitAIRelay - LAN fan-out of WitAITTS streams over UDP multicast
+ *
+ * Copyright (c) 2025 Jobit Joseph, Circuit Digest
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "WitAIRelay.h"
+
+// Packet types
+#define WITAI_RELAY_TYPE_START 0
+#define WITAI_RELAY_TYPE_DATA 1
+#define WITAI_RELAY_TYPE_END 2
+#define WITAI_RELAY_TYPE_ABORT 3
+
+#define WITAI_RELAY_VERSION 1
+
+// ============================================================================
+// CONSTRUCTOR & SETUP
+// ============================================================================
+
+WitAIRelay::WitAIRelay() {
+  _port = WITAI_RELAY_PORT;
+  _mode = WITAI_RELAY_OFF;
+  _session = 0;
+  _seq = 0;
+  _playAtMs = 0;
+  _active = false;
+  _seenSession = false;
+  _hasPrevious = false;
+  _previousSession = 0;
+  resetStats();
+  _resetPeer();
+}
+
+bool WitAIRelay::begin(uint8_t mode, IPAddress group, uint16_t port) {
+  end();
+  _group = group;
+  _seenSession = false;
+  _hasPrevious = false;
+  _port = port;
+
+  if (mode == WITAI_RELAY_PEER) {
+#ifdef ARDUINO_ARCH_RP2040
+    if (!_udp.beginMulticast(WiFi.localIP(), _group, _port))
+      return false;
+#else
+    if (!_udp.beginMulticast(_group, _port))
+      return false;
+#endif
+  } else if (mode == WITAI_RELAY_LEADER) {
+    // Start from an arbitrary session id so peers don't mistake the first
+    // utterance after a leader reboot for one they already played
+    _session = (uint16_t)micros();
+  }
+
+  _mode = mode;
+  return true;
+}
+
+void WitAIRelay::end() {
+  if (_mode == WITAI_RELAY_LEADER)
+    endSession();
+  if (_mode != WITAI_RELAY_OFF)
+    _udp.stop();
+  _mode = WITAI_RELAY_OFF;
+  _active = false;
+  _resetPeer();
+}
+
+uint8_t WitAIRelay::getMode() { return _mode; }
+
+// ============================================================================
+// LEADER
+// ============================================================================
+
+void WitAIRelay::startSession(uint32_t playAtMs) {
+  if (_mode != WITAI_RELAY_LEADER)
+    return;
+  endSession();
+
+  _session++;
+  _seq = 0;
+  _playAtMs = playAtMs;
+  _active = true;
+  _sendPacket(WITAI_RELAY_TYPE_START, nullptr, 0);
+}
+
+void WitAIRelay::send(const uint8_t *data, size_t len) {
+  if (_mode != WITAI_RELAY_LEADER || !_active)
+    return;
+
+  while (len > 0) {
+    size_t chunk = min(len, (size_t)WITAI_RELAY_PAYLOAD);
+    _sendPacket(WITAI_RELAY_TYPE_DATA, data, chunk);
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void WitAIRelay::endSession() {
+  if (_mode != WITAI_RELAY_LEADER || !_active)
+    return;
+  _sendPacket(WITAI_RELAY_TYPE_END, nullptr, 0);
+  _active = false;
+}
+
+void WitAIRelay::abort() {
+  if (_mode == WITAI_RELAY_LEADER) {
+    if (!_active)
+      return;
+    _sendPacket(WITAI_RELAY_TYPE_ABORT, nullptr, 0);
+    _active = false;
+    return;
+  }
+  if (_mode == WITAI_RELAY_PEER && _active)
+    _dropSession();
+}
+
+void WitAIRelay::_sendPacket(uint8_t type, const uint8_t *data, size_t len) {
+  Header header;
+  header.type = type;
+  header.session = _session;
+  header.seq = _seq++;
+  header.senderMs = millis();
+  header.playAtMs = _playAtMs;
+  header.length = len;
+
+  size_t size = _writeHeader(_packet, header);
+  if (len > 0) {
+    memcpy(_packet + size, data, len);
+    size += len;
+  }
+
+#ifdef ARDUINO_ARCH_RP2040
+  _udp.beginPacketMulticast(_group, _port, WiFi.localIP());
+#else
+  _udp.beginPacket(_group, _port);
+#endif
+  _udp.write(_packet, size);
+  _udp.endPacket();
+  _stats.sent++;
+}
+
+// ============================================================================
+// PEER
+// ============================================================================
+
+uint8_t WitAIRelay::poll() {
+  if (_mode != WITAI_RELAY_PEER)
+    return 0;
+
+  uint8_t events = 0;
+
+  // Bounded so a packet storm can't starve the caller's loop
+  for (int i = 0; i < WITAI_RELAY_SLOTS; i++) {
+    int size = _udp.parsePacket();
+    if (size <= 0)
+      break;
+
+    int len = _udp.read(_packet, sizeof(_packet));
+    Header header;
+    if (len <= 0 || !_readHeader(_packet, len, header))
+      continue;
+
+    _stats.received++;
+    events |= _receive(header, _packet + WITAI_RELAY_HEADER_SIZE);
+  }
+
+  if (_active && !_ended && millis() - _lastPacketMs > WITAI_RELAY_TIMEOUT_MS) {
+    _ended = true; // Leader went quiet, play out what we have
+    events |= WITAI_RELAY_EVENT_END;
+  }
+  if (_active && _ended && pending() == 0)
+    _active = false;
+
+  return events;
+}
+
+uint8_t WitAIRelay::_receive(const Header &header, const uint8_t *data) {
+  uint8_t events = 0;
+  uint32_t now = millis();
+  int32_t offset = (int32_t)(now - header.senderMs);
+
+  if (!_active || header.session != _session) {
+    if ((_seenSession && header.session == _session) ||
+        (_hasPrevious && header.session == _previousSession)) {
+      _stats.duplicates++; // Straggler from a session played out or replaced
+      return 0;
+    }
+
+    // New utterance: START (seq 0) carries no payload, data begins at seq 1
+    if (_seenSession) {
+      _previousSession = _session;
+      _hasPrevious = true;
+    }
+    _resetPeer();
+    _session = header.session;
+    _seenSession = true;
+    _active = true;
+    _expected = 1;
+    _offsetMs = offset;
+    events |= WITAI_RELAY_EVENT_START;
+  }
+
+  // The smallest offset seen is the one with the least network delay
+  if (offset < _offsetMs)
+    _offsetMs = offset;
+  _playAtMs = header.playAtMs;
+  _lastPacketMs = now;
+
+  if (header.type == WITAI_RELAY_TYPE_END) {
+    _ended = true;
+    events |= WITAI_RELAY_EVENT_END;
+    return events;
+  }
+  if (header.type == WITAI_RELAY_TYPE_ABORT) {
+    _dropSession();
+    return WITAI_RELAY_EVENT_ABORT; // Also replaces any START just raised
+  }
+  if (header.type != WITAI_RELAY_TYPE_DATA)
+    return events;
+
+  int16_t ahead = (int16_t)(header.seq - _expected);
+  if (ahead < 0) {
+    _stats.duplicates++;
+    return events;
+  }
+
+  // Too far ahead for the jitter buffer: give up on the oldest packets
+  while ((int16_t)(header.seq - _expected) >= WITAI_RELAY_SLOTS) {
+    Slot &oldest = _slots[_expected % WITAI_RELAY_SLOTS];
+    if (oldest.used && oldest.seq == _expected) {
+      _stats.overflow++; // Received but not drained in time
+    } else {
+      _stats.lost++;
+    }
+    oldest.used = false;
+    _expected++;
+  }
+
+  Slot &slot = _slots[header.seq % WITAI_RELAY_SLOTS];
+  if (slot.used && slot.seq == header.seq) {
+    _stats.duplicates++;
+    return events;
+  }
+  for (uint16_t seq = _expected; seq != header.seq; seq++) {
+    Slot &earlier = _slots[seq % WITAI_RELAY_SLOTS];
+    if (!earlier.used || earlier.seq != seq) {
+      _stats.reordered++; // Overtook a packet still missing
+      break;
+    }
+  }
+
+  slot.used = true;
+  slot.seq = header.seq;
+  slot.length = min((size_t)header.length, (size_t)WITAI_RELAY_PAYLOAD);
+  memcpy(slot.data, data, slot.length);
+  return events;
+}
+
+const uint8_t *WitAIRelay::peek(size_t &len) {
+  _skipGaps();
+  Slot &slot = _slots[_expected % WITAI_RELAY_SLOTS];
+  if (!slot.used || slot.seq != _expected)
+    return nullptr;
+
+  len = slot.length;
+  return slot.data;
+}
+
+void WitAIRelay::consume() {
+  Slot &slot = _slots[_expected % WITAI_RELAY_SLOTS];
+  if (!slot.used || slot.seq != _expected)
+    return;
+
+  slot.used = false;
+  _expected++;
+  _stats.delivered++;
+}
+
+size_t WitAIRelay::pending() {
+  size_t count = 0;
+  for (int i = 0; i < WITAI_RELAY_SLOTS; i++) {
+    if (_slots[i].used)
+      count++;
+  }
+  return count;
+}
+
+bool WitAIRelay::isActive() { return _active; }
+
+uint32_t WitAIRelay::playAt() { return _playAtMs + _offsetMs; }
+
+void WitAIRelay::_skipGaps() {
+  Slot &head = _slots[_expected % WITAI_RELAY_SLOTS];
+  if ((head.used && head.seq == _expected) || pending() == 0) {
+    _gapSinceMs = 0;
+    return;
+  }
+
+  // Later packets are waiting on a missing one, wait a little for it
+  uint32_t now = millis();
+  if (_gapSinceMs == 0) {
+    _gapSinceMs = now;
+  } else if (now - _gapSinceMs > WITAI_RELAY_GAP_MS) {
+    _expected++;
+    _stats.lost++;
+    _gapSinceMs = 0;
+  }
+}
+
+// Keep the session id, so its stragglers are dropped as already played
+void WitAIRelay::_dropSession() {
+  _resetPeer();
+  _ended = true;
+  _active = false;
+}
+
+void WitAIRelay::_resetPeer() {
+  for (int i = 0; i < WITAI_RELAY_SLOTS; i++) {
+    _slots[i].used = false;
+  }
+  _ended = false;
+  _expected = 0;
+  _offsetMs = 0;
+  _lastPacketMs = millis();
+  _gapSinceMs = 0;
+}
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+WitAIRelayStats WitAIRelay::getStats() { return _stats; }
+
+void WitAIRelay::resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+// ============================================================================
+// WIRE FORMAT
+// ============================================================================
+
+size_t WitAIRelay::_writeHeader(uint8_t *buf, const Header &header) {
+  buf[0] = 'W';
+  buf[1] = 'T';
+  buf[2] = WITAI_RELAY_VERSION;
+  buf[3] = header.type;
+  buf[4] = header.session & 0xFF;
+  buf[5] = header.session >> 8;
+  buf[6] = header.seq & 0xFF;
+  buf[7] = header.seq >> 8;
+  for (int i = 0; i < 4; i++) {
+    buf[8 + i] = (header.senderMs >> (8 * i)) & 0xFF;
+    buf[12 + i] = (header.playAtMs >> (8 * i)) & 0xFF;
+  }
+  buf[16] = header.length & 0xFF;
+  buf[17] = header.length >> 8;
+  return WITAI_RELAY_HEADER_SIZE;
+}
+
+bool WitAIRelay::_readHeader(const uint8_t *buf, size_t len, Header &header) {
+  if (len < WITAI_RELAY_HEADER_SIZE || buf[0] != 'W' || buf[1] != 'T' ||
+      buf[2] != WITAI_RELAY_VERSION)
+    return false;
+
+  header.type = buf[3];
+  header.session = buf[4] | (buf[5] << 8);
+  header.seq = buf[6] | (buf[7] << 8);
+  header.senderMs = 0;
+  header.playAtMs = 0;
+  for (int i = 0; i < 4; i++) {
+    header.senderMs |= (uint32_t)buf[8 + i] << (8 * i);
+    header.playAtMs |= (uint32_t)buf[12 + i] << (8 * i);
+  }
+  header.length = buf[16] | (buf[17] << 8);
+
+  // Drop truncated packets rather than play garbage
+  return header.length <= len - WITAI_RELAY_HEADER_SIZE;
+}
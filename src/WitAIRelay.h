@@ -0,0 +1,175 @@
+/*
+ * WitAIRelay - LAN fan-out of WitAITTS streams over UDP multicast
+ *
+ * Copyright (c) 2025 Jobit Joseph, Circuit Digest
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WITAIRELAY_H
+#define WITAIRELAY_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+// ============================================================================
+// USER CONFIGURABLE PARAMETERS
+// ============================================================================
+
+#ifndef WITAI_RELAY_GROUP
+#define WITAI_RELAY_GROUP IPAddress(239, 255, 42, 42) // Multicast group
+#endif
+
+#ifndef WITAI_RELAY_PORT
+#define WITAI_RELAY_PORT 5005 // UDP port shared by leader and peers
+#endif
+
+#ifndef WITAI_RELAY_PAYLOAD
+#define WITAI_RELAY_PAYLOAD 512 // Compressed bytes per packet
+#endif
+
+#ifndef WITAI_RELAY_SLOTS
+#define WITAI_RELAY_SLOTS 16 // Reorder/jitter buffer depth (packets)
+#endif
+
+#ifndef WITAI_RELAY_PREROLL
+#define WITAI_RELAY_PREROLL 4096 // Bytes the leader sends ahead of play-out
+#endif
+
+#ifndef WITAI_RELAY_PLAY_DELAY_MS
+#define WITAI_RELAY_PLAY_DELAY_MS 300 // Lead time before the shared play-at
+#endif
+
+#ifndef WITAI_RELAY_GAP_MS
+#define WITAI_RELAY_GAP_MS 60 // Give up on a missing packet after this
+#endif
+
+#ifndef WITAI_RELAY_TIMEOUT_MS
+#define WITAI_RELAY_TIMEOUT_MS 1000 // End a session if the leader goes quiet
+#endif
+
+// Relay Modes
+#define WITAI_RELAY_OFF 0
+#define WITAI_RELAY_LEADER 1
+#define WITAI_RELAY_PEER 2
+
+// Wire header: magic "WT", version, type, session, seq, sender/play-at
+// times and payload length
+#define WITAI_RELAY_HEADER_SIZE 18
+
+// Events returned by poll()
+#define WITAI_RELAY_EVENT_START 0x01
+#define WITAI_RELAY_EVENT_END 0x02
+#define WITAI_RELAY_EVENT_ABORT 0x04 // Leader stopped, drop buffered audio
+
+// ============================================================================
+// WITAIRELAY CLASS
+// ============================================================================
+
+struct WitAIRelayStats {
+  uint32_t sent;       // Packets sent (leader)
+  uint32_t received;   // Packets received (peer)
+  uint32_t delivered;  // Packets handed to the decoder in order (peer)
+  uint32_t reordered;  // Packets that arrived ahead of a missing one (peer)
+  uint32_t duplicates; // Packets dropped as already seen or too late (peer)
+  uint32_t lost;       // Packets skipped after WITAI_RELAY_GAP_MS (peer)
+  uint32_t overflow;   // Packets dropped with the jitter buffer full (peer)
+};
+
+class WitAIRelay {
+public:
+  WitAIRelay();
+
+  bool begin(uint8_t mode, IPAddress group, uint16_t port = WITAI_RELAY_PORT);
+  void end();
+  uint8_t getMode();
+
+  // Leader: one session per utterance, payload is the compressed stream
+  void startSession(uint32_t playAtMs);
+  void send(const uint8_t *data, size_t len);
+  void endSession();
+
+  // Leader tells peers to drop the session, peer drops it locally. Either
+  // way its remaining packets are ignored.
+  void abort();
+
+  // Peer: receive packets, then drain payload in order with peek()/consume()
+  uint8_t poll();
+  const uint8_t *peek(size_t &len);
+  void consume();
+  size_t pending();
+  bool isActive();   // Session started and not yet fully delivered
+  uint32_t playAt(); // Shared play-at time in local millis()
+
+  WitAIRelayStats getStats();
+  void resetStats();
+
+private:
+  // Wire header, serialised little-endian by _writeHeader()/_readHeader()
+  struct Header {
+    uint8_t type;
+    uint16_t session;
+    uint16_t seq;
+    uint32_t senderMs;
+    uint32_t playAtMs;
+    uint16_t length;
+  };
+
+  struct Slot {
+    bool used;
+    uint16_t seq;
+    uint16_t length;
+    uint8_t data[WITAI_RELAY_PAYLOAD];
+  };
+
+  WiFiUDP _udp;
+  IPAddress _group;
+  uint16_t _port;
+  uint8_t _mode;
+  WitAIRelayStats _stats;
+
+  // Session state (leader sends it, peer follows it)
+  uint16_t _session;
+  uint16_t _seq;
+  uint32_t _playAtMs;
+  bool _active;
+  uint8_t _packet[WITAI_RELAY_HEADER_SIZE + WITAI_RELAY_PAYLOAD];
+
+  // Peer state
+  Slot _slots[WITAI_RELAY_SLOTS];
+  bool _seenSession;
+  bool _hasPrevious;
+  uint16_t _previousSession; // Replaced session, its late packets are dropped
+  bool _ended;
+  uint16_t _expected;
+  int32_t _offsetMs; // Smallest local - sender clock difference seen
+  uint32_t _lastPacketMs;
+  uint32_t _gapSinceMs;
+
+  void _sendPacket(uint8_t type, const uint8_t *data, size_t len);
+  uint8_t _receive(const Header &header, const uint8_t *data);
+  void _skipGaps();
+  void _resetPeer();
+  void _dropSession();
+  static size_t _writeHeader(uint8_t *buf, const Header &header);
+  static bool _readHeader(const uint8_t *buf, size_t len, Header &header);
+};
+
+#endif // WITAIRELAY_H
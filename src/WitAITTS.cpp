@@ -33,6 +33,7 @@ WitAITTS::WitAITTS(uint8_t bclkPin, uint8_t lrcPin, uint8_t dinPin,
                    uint32_t bufferSize)
     : _bclkPin(bclkPin), _lrcPin(lrcPin), _dinPin(dinPin) {
   _audio = nullptr;
+  _mixerOut = nullptr;
   _mp3 = nullptr;
   _stream = nullptr;
   _isStreaming = false;
@@ -45,17 +46,24 @@ WitAITTS::WitAITTS(uint8_t bclkPin, uint8_t lrcPin, uint8_t dinPin,
 WitAITTS::WitAITTS(uint8_t bclkPin, uint8_t lrcPin, uint8_t dinPin)
     : _bclkPin(bclkPin), _lrcPin(lrcPin), _dinPin(dinPin) {
   _i2s = nullptr;
+  _mixerStream = nullptr;
   _decoder = nullptr;
   _mp3Decoder = nullptr;
   _isPlaying = false;
+  _relayFormatPending = false;
+  _relayProbeLen = 0;
   _initDefaults();
 }
 #endif
 
 WitAITTS::~WitAITTS() {
+  if (_relay)
+    delete _relay;
 #ifdef ARDUINO_ARCH_ESP32
   if (_mp3)
     delete _mp3;
+  if (_mixerOut)
+    delete _mixerOut;
   if (_audio)
     delete _audio;
 #elif defined(ARDUINO_ARCH_RP2040)
@@ -63,6 +71,8 @@ WitAITTS::~WitAITTS() {
     delete _decoder;
   if (_mp3Decoder)
     delete _mp3Decoder;
+  if (_mixerStream)
+    delete _mixerStream;
   if (_i2s)
     delete _i2s;
 #endif
@@ -75,6 +85,10 @@ WitAITTS::~WitAITTS() {
 void WitAITTS::_initDefaults() {
   _initialized = false;
   _errorCallback = nullptr;
+  _relay = nullptr;
+  _relayPlayAt = 0;
+  _relayHold = false;
+  resetLoopStats();
 
   // Default settings
   _voice = "wit$Remi";
@@ -86,6 +100,14 @@ void WitAITTS::_initDefaults() {
   _gain = 0.5;
   _audioFormat = "audio/mpeg";
   _debugLevel = DEBUG_INFO;
+  _outputRate = 0;
+  _outputChannels = 0;
+  _repeatWindowMs = 0;
+  _hasLastRequest = false;
+  _lastRequestHash = 0;
+  _lastRequestMs = 0;
+  resetRequestStats();
+  memset(&_reportedFormat, 0, sizeof(_reportedFormat));
 }
 
 bool WitAITTS::begin(const char *ssid, const char *password,
@@ -101,28 +123,35 @@ bool WitAITTS::begin(const char *ssid, const char *password,
   // Set CPU to max speed for smooth streaming
   setCpuFrequencyMhz(240);
 
-  // Initialize audio objects
+  // Initialize audio objects (decoder -> mixer -> I2S)
   _audio = new ESP32I2SAudio(_bclkPin, _lrcPin, _dinPin);
-  _mp3 = new BackgroundAudioMP3Class<RawDataBuffer<WITAI_BUFFER_SIZE>>(*_audio);
+  _mixerOut = new WitAIMixerOutput(*_audio, _mixer);
+  _mixerOut->setFixedFormat(_outputRate, _outputChannels);
+  _mp3 =
+      new BackgroundAudioMP3Class<RawDataBuffer<WITAI_BUFFER_SIZE>>(*_mixerOut);
   _mp3->setGain(_gain);
   _mp3->begin();
 #endif
 
 #ifdef ARDUINO_ARCH_RP2040
-  // Initialize I2S audio
+  // Initialize I2S audio (starting format only, each stream renegotiates it
+  // from its first MP3 frame unless setOutputFormat() fixed it)
   _i2s = new I2SStream();
   auto cfg = _i2s->defaultConfig(TX_MODE);
-  cfg.sample_rate = 44100;
+  cfg.sample_rate = _outputRate ? _outputRate : 44100;
   cfg.bits_per_sample = 16;
-  cfg.channels = 2;
+  cfg.channels = _outputChannels ? _outputChannels : 2;
   cfg.pin_bck = _bclkPin;
   cfg.pin_ws = _lrcPin;
   cfg.pin_data = _dinPin;
   _i2s->begin(cfg);
 
-  // Initialize decoder
+  // Initialize decoder (decoder -> mixer -> I2S)
+  _mixerStream = new WitAIMixerStream(*_i2s, _mixer);
+  _mixerStream->setFixedFormat(_outputRate, _outputChannels);
+  _mixerStream->begin();
   _mp3Decoder = new MP3DecoderHelix();
-  _decoder = new EncodedAudioStream(_i2s, _mp3Decoder);
+  _decoder = new EncodedAudioStream(_mixerStream, _mp3Decoder);
   _decoder->begin();
 #endif
 
@@ -190,11 +219,45 @@ bool WitAITTS::speak(String text) {
     return false;
   }
 
+  // Identical request (same payload and format) already in flight or just
+  // played: attach to it instead of opening a new stream
+  String payload = _buildPayload(text);
+  uint32_t hash = _hashRequest(payload);
+  uint32_t now = millis();
+  if (_hasLastRequest && hash == _lastRequestHash) {
+    if (isBusy()) {
+      _requestStats.coalesced++;
+      _debugPrint(DEBUG_INFO, "Coalesced with in-flight request");
+      return true;
+    }
+    if (_repeatWindowMs > 0 && now - _lastRequestMs < _repeatWindowMs) {
+      _requestStats.suppressed++;
+      _debugPrint(DEBUG_INFO, "Repeat suppressed");
+      return true;
+    }
+  }
+
+#ifdef ARDUINO_ARCH_ESP32
+  _playWitTTS_ESP32(text, payload);
+  bool ok = _isStreaming;
+#elif defined(ARDUINO_ARCH_RP2040)
+  bool ok = _playWitTTS_Pico(text, payload);
+#endif
+
+  // Only successful requests are remembered, so a failed one can be retried.
+  // The repeat window runs from when the request finishes: the Pico returns
+  // after playback, on ESP32 loop() moves it on while still in flight.
+  _hasLastRequest = ok;
+  if (ok) {
+    _lastRequestHash = hash;
+    _lastRequestMs = millis();
+    _requestStats.requests++;
+  }
+
 #ifdef ARDUINO_ARCH_ESP32
-  _playWitTTS_ESP32(text);
   return true;
 #elif defined(ARDUINO_ARCH_RP2040)
-  return _playWitTTS_Pico(text);
+  return ok;
 #endif
 }
 
@@ -203,7 +266,7 @@ bool WitAITTS::speak(String text) {
 // ============================================================================
 
 #ifdef ARDUINO_ARCH_ESP32
-void WitAITTS::_playWitTTS_ESP32(String text) {
+void WitAITTS::_playWitTTS_ESP32(String text, String payload) {
   // Stop any current playback
   if (_isStreaming) {
     _http.end();
@@ -216,9 +279,6 @@ void WitAITTS::_playWitTTS_ESP32(String text) {
 
   _debugPrint(DEBUG_INFO, "Requesting TTS: " + text.substring(0, 30) + "...");
 
-  // Build JSON payload
-  String payload = _buildPayload(text);
-
   // Make HTTP request
   String url = "https://" + String(WITAI_HOST) + String(WITAI_PATH);
   if (!_http.begin(_secureClient, url)) {
@@ -238,21 +298,73 @@ void WitAITTS::_playWitTTS_ESP32(String text) {
     _isStreaming = true;
     _downloadCompleted = false;
     _mp3->pause(); // Start paused for buffering
+
+    // Relay leader: peers and this device start together at play-at
+    if (_isRelay(WITAI_RELAY_LEADER)) {
+      _relayPlayAt = millis() + WITAI_RELAY_PLAY_DELAY_MS;
+      _relayHold = true;
+      _relay->startSession(_relayPlayAt);
+    }
   } else {
     _reportError("HTTP Error: " + String(httpCode));
     _http.end();
   }
 }
 
-void WitAITTS::loop() {
+void WitAITTS::loop(uint32_t budgetUs) {
+  uint32_t startUs = micros();
+  uint32_t sliceUs = 0;
+
+  // Relay peer: feed frames received from the leader
+  if (_isRelay(WITAI_RELAY_PEER))
+    _serviceRelayPeer();
+
   // Download Logic
   if (_isStreaming && _stream) {
-    // Read data actively (multiple reads per loop for smooth streaming)
-    for (int i = 0; i < 4; i++) {
+    size_t fill = _mp3->available();
+    _loopStats.fillPercent = (fill * 100) / WITAI_BUFFER_SIZE;
+
+    // Scale the read slice by buffer urgency: near underrun gets the whole
+    // budget, a comfortably full buffer gets none so the sketch keeps its time
+    if (fill >= WITAI_BUFFER_HIGH_LEVEL) {
+      _loopStats.skipped++;
+    } else if (fill <= WITAI_BUFFER_LOW_LEVEL) {
+      // Near underrun always reads, even when called with a zero budget
+      sliceUs = max(budgetUs, (uint32_t)WITAI_LOOP_MIN_BUDGET_US);
+    } else {
+      sliceUs = (uint64_t)budgetUs * (WITAI_BUFFER_HIGH_LEVEL - fill) /
+                (WITAI_BUFFER_HIGH_LEVEL - WITAI_BUFFER_LOW_LEVEL);
+      if (sliceUs < WITAI_LOOP_MIN_BUDGET_US)
+        sliceUs = min(budgetUs, (uint32_t)WITAI_LOOP_MIN_BUDGET_US);
+    }
+    _loopStats.sliceUs = sliceUs;
+
+    // Read until the slice is used up (at least one read once granted)
+    bool firstRead = true;
+    while (sliceUs > 0 && (firstRead || micros() - startUs < sliceUs)) {
+      firstRead = false;
+      int space = _mp3->availableForWrite();
+      if (space <= 0)
+        break;
+
+      // Relay leader: read no further ahead of play-out than peers can
+      // hold, so packets go out at the rate they are played
+      bool leader = _isRelay(WITAI_RELAY_LEADER);
+      if (leader && _relay->isActive()) {
+        space = min(space, WITAI_RELAY_PREROLL - (int)_mp3->available());
+        if (space < WITAI_RELAY_PAYLOAD)
+          break;
+      }
+
       if (_stream->available()) {
-        int bytesRead = _stream->read(_networkBuffer, WITAI_NETWORK_BUFFER);
+        size_t toRead = min((size_t)space, (size_t)WITAI_NETWORK_BUFFER);
+        int bytesRead = _stream->read(_networkBuffer, toRead);
         if (bytesRead > 0) {
           _mp3->write(_networkBuffer, bytesRead);
+          if (leader)
+            _relay->send(_networkBuffer, bytesRead);
+          _loopStats.reads++;
+          _loopStats.bytes += bytesRead;
           _debugPrint(DEBUG_VERBOSE, "Read: " + String(bytesRead) + " bytes");
         }
       } else if (!_stream->connected()) {
@@ -261,15 +373,32 @@ void WitAITTS::loop() {
         _isStreaming = false;
         _downloadCompleted = true;
         _stream = nullptr;
+        if (leader)
+          _relay->endSession();
         break;
+      } else {
+        break; // Nothing received yet, don't spin on an empty socket
       }
     }
   }
 
+  // Report the format once the decoder has negotiated it
+  _reportFormat();
+
   // Playback Logic
   if (_mp3->paused()) {
+    // Relay: hold until the shared play-at time so all rooms start together
+    if (_relayHold) {
+      // The pre-roll is the buffer, start on time even if it is short
+      if ((int32_t)(millis() - _relayPlayAt) >= 0) {
+        _debugPrint(DEBUG_INFO, "Relay: play-at reached, starting playback");
+        _mp3->unpause();
+        _downloadCompleted = false;
+        _relayHold = false;
+      }
+    }
     // Paused/Buffering state
-    if (_mp3->available() > WITAI_BUFFER_START_LEVEL) {
+    else if (_mp3->available() > WITAI_BUFFER_START_LEVEL) {
       _debugPrint(DEBUG_INFO, "Buffer ready, starting playback");
       _mp3->unpause();
     }
@@ -281,6 +410,16 @@ void WitAITTS::loop() {
     }
   }
 
+  if (_hasLastRequest && isBusy())
+    _lastRequestMs = millis();
+
+  uint32_t elapsedUs = micros() - startUs;
+  _loopStats.lastUs = elapsedUs;
+  if (elapsedUs > _loopStats.maxUs)
+    _loopStats.maxUs = elapsedUs;
+  if (elapsedUs > budgetUs)
+    _loopStats.overBudget++;
+
   yield();
 }
 
@@ -292,13 +431,69 @@ void WitAITTS::stop() {
   }
   if (_mp3) {
     _mp3->pause();
+    _mp3->flush(); // Drop buffered audio so isBusy() ends
   }
+  _downloadCompleted = false;
+  if (_relay)
+    _relay->abort();
+  _relayHold = false;
+  _hasLastRequest = false; // Speaking the same text again should replay it
   _debugPrint(DEBUG_INFO, "Stopped");
 }
 
+void WitAITTS::_serviceRelayPeer() {
+  uint8_t events = _relay->poll();
+
+  if (events & WITAI_RELAY_EVENT_START) {
+    // The leader's utterance replaces whatever this device was doing
+    if (_isStreaming) {
+      _http.end();
+      _isStreaming = false;
+      _stream = nullptr;
+    }
+    _mp3->pause();
+    _mp3->flush();
+    _downloadCompleted = false;
+    _relayHold = true;
+    _hasLastRequest = false; // The local request was cut off
+    _debugPrint(DEBUG_INFO, "Relay: utterance from leader");
+  }
+
+  if (events & WITAI_RELAY_EVENT_ABORT) {
+    // Leader called stop(): drop what is buffered so all rooms go quiet
+    _mp3->pause();
+    _mp3->flush();
+    _downloadCompleted = false;
+    _relayHold = false;
+    _debugPrint(DEBUG_INFO, "Relay: stopped by leader");
+    return;
+  }
+
+  // Play-at estimate tightens as lower-latency packets arrive
+  if (_relayHold)
+    _relayPlayAt = _relay->playAt();
+
+  size_t len;
+  const uint8_t *data;
+  while ((data = _relay->peek(len)) != nullptr) {
+    if ((size_t)_mp3->availableForWrite() < len)
+      break; // Ring buffer full, the jitter buffer holds the rest
+    _mp3->write(data, len);
+    _relay->consume();
+  }
+
+  if (events & WITAI_RELAY_EVENT_END)
+    _downloadCompleted = true;
+}
+
 bool WitAITTS::isPlaying() { return (_mp3 && !_mp3->paused()); }
 
-bool WitAITTS::isBusy() { return _isStreaming || isPlaying(); }
+// In flight while downloading or while decoded audio is still buffered. The
+// decoder is only paused by speak()/stop(), so paused() can't tell this.
+bool WitAITTS::isBusy() {
+  return _isStreaming || (_mp3 && _mp3->available() > 0) ||
+         (_relay && _relay->isActive());
+}
 #endif
 
 // ============================================================================
@@ -306,9 +501,10 @@ bool WitAITTS::isBusy() { return _isStreaming || isPlaying(); }
 // ============================================================================
 
 #ifdef ARDUINO_ARCH_RP2040
-bool WitAITTS::_playWitTTS_Pico(String text) {
+bool WitAITTS::_playWitTTS_Pico(String text, String payload) {
   _isPlaying = true;
 
+  _debugPrint(DEBUG_INFO, "Requesting TTS: " + text.substring(0, 30) + "...");
   _debugPrint(DEBUG_INFO, "Connecting to " + String(WITAI_HOST));
 
   if (!_secureClient.connect(WITAI_HOST, WITAI_PORT)) {
@@ -317,9 +513,6 @@ bool WitAITTS::_playWitTTS_Pico(String text) {
     return false;
   }
 
-  // Build payload
-  String payload = _buildPayload(text);
-
   // Send HTTP request manually
   _secureClient.printf("POST %s HTTP/1.1\r\n", WITAI_PATH);
   _secureClient.printf("Host: %s\r\n", WITAI_HOST);
@@ -346,16 +539,49 @@ bool WitAITTS::_playWitTTS_Pico(String text) {
 
   // Skip headers
   _skipHeaders();
+
+  // Negotiate the output format from the first MP3 frame, so I2S runs at the
+  // stream's native rate/channels before any audio reaches it
+  size_t probeLen =
+      _secureClient.readBytes(_networkBuffer, WITAI_FORMAT_PROBE_SIZE);
+  _setStreamFormat(_networkBuffer, probeLen);
+
+  // Relay leader: peers buffer until play-at, so hold back locally too.
+  // The pre-roll sent meanwhile is kept in the network buffer.
+  size_t preroll = probeLen;
+  bool leader = _isRelay(WITAI_RELAY_LEADER);
+  if (leader) {
+    uint32_t playAt = millis() + WITAI_RELAY_PLAY_DELAY_MS;
+    size_t limit = min((size_t)WITAI_RELAY_PREROLL, sizeof(_networkBuffer));
+    _relay->startSession(playAt);
+    _relay->send(_networkBuffer, probeLen);
+    while ((int32_t)(millis() - playAt) < 0) {
+      int n = 0;
+      if (preroll < limit && _secureClient.available())
+        n = _secureClient.read(_networkBuffer + preroll, limit - preroll);
+      if (n > 0) {
+        _relay->send(_networkBuffer + preroll, n);
+        preroll += n;
+      } else {
+        delay(1);
+      }
+    }
+  }
+  _decoder->write(_networkBuffer, preroll);
+
   _debugPrint(DEBUG_INFO, "Streaming audio...");
 
-  // Stream audio using StreamCopy
-  StreamCopy copier(*_decoder, _secureClient);
+  // Stream audio, forwarding each chunk to relay peers as it is decoded.
+  // Decoder writes block on I2S, which paces the relay to play-out.
   unsigned long lastData = millis();
 
   while (true) {
-    size_t n = copier.copy();
+    int n = _secureClient.read(_networkBuffer, WITAI_NETWORK_BUFFER);
 
     if (n > 0) {
+      _decoder->write(_networkBuffer, n);
+      if (leader)
+        _relay->send(_networkBuffer, n);
       lastData = millis();
     } else {
       delay(1);
@@ -367,12 +593,29 @@ bool WitAITTS::_playWitTTS_Pico(String text) {
     }
   }
 
+  if (leader)
+    _relay->endSession();
   _secureClient.stop();
   _isPlaying = false;
   _debugPrint(DEBUG_INFO, "Playback finished");
   return true;
 }
 
+void WitAITTS::_setStreamFormat(const uint8_t *data, size_t len) {
+  uint32_t sampleRate;
+  uint8_t channels;
+  if (!WitAIMP3Header::parse(data, len, sampleRate, channels)) {
+    _debugPrint(DEBUG_VERBOSE, "No MP3 frame header found, keeping format");
+    return;
+  }
+
+  AudioInfo info = _mixerStream->audioInfo();
+  info.sample_rate = sampleRate;
+  info.channels = channels;
+  _mixerStream->setAudioInfo(info);
+  _reportFormat();
+}
+
 void WitAITTS::_skipHeaders() {
   while (_secureClient.connected()) {
     String line = _secureClient.readStringUntil('\n');
@@ -382,16 +625,91 @@ void WitAITTS::_skipHeaders() {
   }
 }
 
-void WitAITTS::loop() {
-  // Pico uses blocking playback, loop() does nothing
+void WitAITTS::loop(uint32_t budgetUs) {
+  // Pico uses blocking playback, loop() only feeds relay frames and mixer
+  // clips between speech
+  (void)budgetUs;
+  if (_isRelay(WITAI_RELAY_PEER))
+    _serviceRelayPeer();
+  if (!_isPlaying && _mixerStream)
+    _mixerStream->pump();
   yield();
 }
 
+void WitAITTS::_serviceRelayPeer() {
+  uint8_t events = _relay->poll();
+
+  if (events & WITAI_RELAY_EVENT_START) {
+    _isPlaying = true;
+    _relayHold = true;
+    _relayFormatPending = true;
+    _relayProbeLen = 0;
+    _debugPrint(DEBUG_INFO, "Relay: utterance from leader");
+  }
+
+  if (events & WITAI_RELAY_EVENT_ABORT) {
+    // Leader called stop(): drop the collected probe and stop feeding
+    _relayHold = false;
+    _relayFormatPending = false;
+    _isPlaying = false;
+    _debugPrint(DEBUG_INFO, "Relay: stopped by leader");
+    return;
+  }
+
+  // Hold frames until the shared play-at time. The leader sends at most
+  // WITAI_RELAY_PREROLL bytes ahead, which the jitter buffer holds.
+  if (_relayHold) {
+    if ((int32_t)(millis() - _relay->playAt()) < 0)
+      return;
+    _relayHold = false;
+  }
+
+  size_t len;
+  const uint8_t *data;
+  while ((data = _relay->peek(len)) != nullptr) {
+    if (_relayFormatPending) {
+      // Collect payload until two frame headers confirm the format
+      if (_relayProbeLen + len <= sizeof(_networkBuffer)) {
+        memcpy(_networkBuffer + _relayProbeLen, data, len);
+        _relayProbeLen += len;
+        _relay->consume();
+        uint32_t sampleRate;
+        uint8_t channels;
+        if (_relayProbeLen < WITAI_FORMAT_PROBE_SIZE &&
+            !WitAIMP3Header::parse(_networkBuffer, _relayProbeLen, sampleRate,
+                                   channels))
+          continue;
+      }
+      _setStreamFormat(_networkBuffer, _relayProbeLen);
+      _decoder->write(_networkBuffer, _relayProbeLen);
+      _relayFormatPending = false;
+      continue;
+    }
+    _decoder->write(data, len);
+    _relay->consume();
+  }
+
+  if (!_relay->isActive()) {
+    // Utterance shorter than the probe: play what was collected
+    if (_relayFormatPending && _relayProbeLen > 0) {
+      _setStreamFormat(_networkBuffer, _relayProbeLen);
+      _decoder->write(_networkBuffer, _relayProbeLen);
+    }
+    _relayFormatPending = false;
+    _isPlaying = false;
+  }
+}
+
 void WitAITTS::stop() {
   if (_secureClient.connected()) {
     _secureClient.stop();
   }
+  if (_relay)
+    _relay->abort();
+  _relayHold = false;
+  _relayFormatPending = false;
   _isPlaying = false;
+  _hasLastRequest = false; // Speaking the same text again should replay it
   _debugPrint(DEBUG_INFO, "Stopped");
 }
 
@@ -400,10 +718,117 @@ bool WitAITTS::isPlaying() { return _isPlaying; }
 bool WitAITTS::isBusy() { return _isPlaying; }
 #endif
 
+// ============================================================================
+// MIXER
+// ============================================================================
+
+int WitAITTS::playClip(const int16_t *pcm, size_t frames, uint32_t sampleRate,
+                       uint8_t channels, float gain) {
+  int channel = _mixer.play(pcm, frames, sampleRate, channels, gain);
+  if (channel < 0) {
+    _reportError("Mixer: clip rejected (no free channel or bad format)");
+  } else {
+    _debugPrint(DEBUG_VERBOSE, "Clip on channel " + String(channel));
+  }
+  return channel;
+}
+
+int WitAITTS::playSource(WitAIMixerSource source, void *context,
+                         uint32_t sampleRate, uint8_t channels, float gain) {
+  int channel = _mixer.play(source, context, sampleRate, channels, gain);
+  if (channel < 0) {
+    _reportError("Mixer: source rejected (no free channel or bad format)");
+  } else {
+    _debugPrint(DEBUG_VERBOSE, "Source on channel " + String(channel));
+  }
+  return channel;
+}
+
+void WitAITTS::stopClip(int channel) {
+  if (channel < 0) {
+    _mixer.stopAll();
+  } else {
+    _mixer.stop(channel);
+  }
+}
+
+void WitAITTS::setClipGain(int channel, float gain) {
+  _mixer.setGain(channel, gain);
+}
+
+bool WitAITTS::isClipPlaying(int channel) {
+  return (channel < 0) ? _mixer.isActive() : _mixer.isActive(channel);
+}
+
+// ============================================================================
+// RELAY
+// ============================================================================
+
+bool WitAITTS::setRelayMode(uint8_t mode, IPAddress group, uint16_t port) {
+  if (!_initialized) {
+    _reportError("Relay: call begin() first");
+    return false;
+  }
+
+  if (mode == WITAI_RELAY_OFF) {
+    if (_relay) {
+      _relay->end();
+      delete _relay;
+      _relay = nullptr;
+    }
+    _relayHold = false;
+    _debugPrint(DEBUG_INFO, "Relay: off");
+    return true;
+  }
+
+  // Only allocated when used: the jitter buffer alone is several KB
+  if (!_relay)
+    _relay = new WitAIRelay();
+  if (!_relay->begin(mode, group, port)) {
+    _reportError("Relay: multicast setup failed");
+    delete _relay;
+    _relay = nullptr;
+    return false;
+  }
+
+  _debugPrint(DEBUG_INFO, "Relay: " +
+                              String(mode == WITAI_RELAY_LEADER ? "leader"
+                                                                : "peer") +
+                              " on " + group.toString() + ":" + String(port));
+  return true;
+}
+
+WitAIRelayStats WitAITTS::getRelayStats() {
+  WitAIRelayStats stats;
+  if (_relay)
+    return _relay->getStats();
+  memset(&stats, 0, sizeof(stats));
+  return stats;
+}
+
+bool WitAITTS::_isRelay(uint8_t mode) {
+  return _relay && _relay->getMode() == mode;
+}
+
 // ============================================================================
 // COMMON HELPER FUNCTIONS
 // ============================================================================
 
+uint32_t WitAITTS::_hashRequest(const String &payload) {
+  // FNV-1a over the payload and Accept format, enough to spot repeats
+  uint32_t hash = 2166136261UL;
+  const char *parts[2] = {payload.c_str(), _audioFormat.c_str()};
+  for (int p = 0; p < 2; p++) {
+    for (const char *c = parts[p]; *c; c++) {
+      hash ^= (uint8_t)*c;
+      hash *= 16777619UL;
+    }
+    hash ^= 0xFF; // Separator so "ab"+"c" != "a"+"bc"
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
 String WitAITTS::_buildSSML(String text) {
   String ssml = "<speak><sfx character='" + _sfxCharacter + "' environment='" +
                 _sfxEnvironment + "'>" + text + "</sfx></speak>";
@@ -481,6 +906,29 @@ void WitAITTS::setDebugLevel(uint8_t level) {
   _debugPrint(DEBUG_INFO, "Debug Level: " + String(_debugLevel));
 }
 
+void WitAITTS::setOutputFormat(uint32_t sampleRate, uint8_t channels) {
+  // The output stage is in use by the audio task once begin() has run, so
+  // the format is only taken here and applied by begin()
+  if (_initialized) {
+    _reportError("Output format: call before begin()");
+    return;
+  }
+
+  _outputRate = sampleRate;
+  _outputChannels = (channels > 2) ? 2 : channels;
+  if (_outputRate == 0 && _outputChannels == 0) {
+    _debugPrint(DEBUG_INFO, "Output format: native");
+  } else {
+    _debugPrint(DEBUG_INFO, "Output format fixed: " + String(_outputRate) +
+                                " Hz, " + String(_outputChannels) + " ch");
+  }
+}
+
+void WitAITTS::setRepeatSuppression(uint32_t windowMs) {
+  _repeatWindowMs = windowMs;
+  _debugPrint(DEBUG_INFO, "Repeat suppression: " + String(windowMs) + " ms");
+}
+
 void WitAITTS::setPins(uint8_t bclk, uint8_t lrc, uint8_t din) {
   _bclkPin = bclk;
   _lrcPin = lrc;
@@ -507,6 +955,7 @@ void WitAITTS::printConfig() {
   Serial.println("SFX Environment: " + _sfxEnvironment);
   Serial.println("Gain: " + String(_gain));
   Serial.println("Format: " + _audioFormat);
+  Serial.println("Output: " + _formatToString(getOutputFormat()));
   Serial.println("Debug: " + String(_debugLevel));
   Serial.println("Pins: BCLK=" + String(_bclkPin) + " LRC=" + String(_lrcPin) +
                  " DIN=" + String(_dinPin));
@@ -528,6 +977,56 @@ String WitAITTS::getConfig() {
   return config;
 }
 
+WitAIAudioFormat WitAITTS::getOutputFormat() {
+#ifdef ARDUINO_ARCH_ESP32
+  if (_mixerOut)
+    return _mixerOut->getFormat();
+#elif defined(ARDUINO_ARCH_RP2040)
+  if (_mixerStream)
+    return _mixerStream->getFormat();
+#endif
+  WitAIAudioFormat none;
+  memset(&none, 0, sizeof(none));
+  return none;
+}
+
+String WitAITTS::_formatToString(WitAIAudioFormat format) {
+  if (format.sampleRate == 0)
+    return "not negotiated";
+
+  String text = String(format.sampleRate) + " Hz, " +
+                String(format.channels == 1 ? "mono" : "stereo");
+  if (format.resampled) {
+    text += " (converted from " + String(format.sourceRate) + " Hz, " +
+            String(format.sourceChannels == 1 ? "mono" : "stereo") + ")";
+  } else {
+    text += " (native)";
+  }
+  return text;
+}
+
+void WitAITTS::_reportFormat() {
+  WitAIAudioFormat format = getOutputFormat();
+  if (format.sampleRate == _reportedFormat.sampleRate &&
+      format.channels == _reportedFormat.channels &&
+      format.sourceRate == _reportedFormat.sourceRate &&
+      format.sourceChannels == _reportedFormat.sourceChannels)
+    return;
+
+  _reportedFormat = format;
+  _debugPrint(DEBUG_INFO, "Output: " + _formatToString(format));
+}
+
+WitAILoopStats WitAITTS::getLoopStats() { return _loopStats; }
+
+void WitAITTS::resetLoopStats() { memset(&_loopStats, 0, sizeof(_loopStats)); }
+
+WitAIRequestStats WitAITTS::getRequestStats() { return _requestStats; }
+
+void WitAITTS::resetRequestStats() {
+  memset(&_requestStats, 0, sizeof(_requestStats));
+}
+
 // ============================================================================
 // DEBUG & ERROR HANDLING
 // ============================================================================
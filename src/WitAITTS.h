@@ -29,6 +29,9 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 
+#include "WitAIMixer.h"
+#include "WitAIRelay.h"
+
 // ============================================================================
 // PLATFORM-SPECIFIC INCLUDES AND DEFAULTS
 // ============================================================================
@@ -74,6 +77,17 @@
 #define WITAI_BUFFER_START_LEVEL                                               \
   (1 * 1024) // Wait for this much data before playing
 #define WITAI_BUFFER_LOW_LEVEL (1 * 1024) // Pause if buffer drops below this
+#define WITAI_BUFFER_HIGH_LEVEL                                                \
+  (WITAI_BUFFER_SIZE - WITAI_NETWORK_BUFFER) // Skip reads above this
+
+// Loop Scheduling (ESP32 only)
+#define WITAI_LOOP_BUDGET_US 4000 // Default time budget per loop() call
+#define WITAI_LOOP_MIN_BUDGET_US                                               \
+  500 // Smallest slice spent reading when below the high level
+
+// Output Format (Pico probes the first MP3 frame before playback)
+#define WITAI_FORMAT_PROBE_SIZE                                                \
+  1024 // Bytes read to find two frame headers (<= WITAI_NETWORK_BUFFER / 2)
 
 // Text Configuration
 #define WITAI_MAX_TEXT_LENGTH 280 // Maximum text length (Wit.ai limit)
@@ -89,6 +103,29 @@
 #define WITAI_PORT 443
 #define WITAI_PATH "/synthesize?v=20240304"
 
+// ============================================================================
+// LOOP STATISTICS
+// ============================================================================
+
+// Per-call timing of the cooperative loop() scheduler
+struct WitAILoopStats {
+  uint32_t lastUs;      // Time spent in the most recent loop() call
+  uint32_t maxUs;       // Longest loop() call since reset
+  uint32_t sliceUs;     // Slice granted to reading in the most recent call
+  uint32_t reads;       // Network reads performed since reset
+  uint32_t bytes;       // Bytes moved into the ring buffer since reset
+  uint32_t skipped;     // Calls that skipped reading (buffer comfortably full)
+  uint32_t overBudget;  // Calls that exceeded their requested budget
+  uint8_t fillPercent;  // Ring buffer fill level at the start of the last call
+};
+
+// Requests saved by coalescing identical utterances
+struct WitAIRequestStats {
+  uint32_t requests;   // Requests actually sent to Wit.ai
+  uint32_t coalesced;  // speak() calls attached to an identical in-flight one
+  uint32_t suppressed; // speak() calls dropped inside the repeat window
+};
+
 // ============================================================================
 // WITAITTS CLASS
 // ============================================================================
@@ -115,7 +152,7 @@ public:
   // Core Functions
   bool speak(String text);
   void stop();
-  void loop(); // Required for ESP32, optional for Pico (blocking)
+  void loop(uint32_t budgetUs = WITAI_LOOP_BUDGET_US); // Required for ESP32
   bool isPlaying();
   bool isBusy();
 
@@ -129,13 +166,35 @@ public:
   void setGain(float gain);           // 0.0-1.0, default 0.5
   void setAudioFormat(String format); // "audio/mpeg" or "audio/pcm16"
   void setDebugLevel(uint8_t level);  // 0-3
+  void setRepeatSuppression(uint32_t windowMs); // 0 = off (default)
+
+  // Mixer - local clips/streams over or between speech (call after begin())
+  int playClip(const int16_t *pcm, size_t frames, uint32_t sampleRate,
+               uint8_t channels = 1, float gain = 1.0f);
+  int playSource(WitAIMixerSource source, void *context, uint32_t sampleRate,
+                 uint8_t channels = 1, float gain = 1.0f);
+  void stopClip(int channel = -1); // -1 stops all clips
+  void setClipGain(int channel, float gain);
+  bool isClipPlaying(int channel = -1);
+
+  // LAN relay (call after begin()) - leader fetches, peers play in sync
+  bool setRelayMode(uint8_t mode, IPAddress group = WITAI_RELAY_GROUP,
+                    uint16_t port = WITAI_RELAY_PORT);
+  WitAIRelayStats getRelayStats();
 
-  // Pin reconfiguration (call before begin())
+  // I2S setup (call before begin())
   void setPins(uint8_t bclk, uint8_t lrc, uint8_t din);
+  void setOutputFormat(uint32_t sampleRate = 0,
+                       uint8_t channels = 0); // 0 = follow the stream
 
   // Status
   void printConfig();
   String getConfig();
+  WitAIAudioFormat getOutputFormat();
+  WitAILoopStats getLoopStats();
+  void resetLoopStats();
+  WitAIRequestStats getRequestStats();
+  void resetRequestStats();
 
   // Error Callback (optional)
   void setErrorCallback(void (*callback)(String error));
@@ -144,21 +203,33 @@ private:
 // Platform-specific audio objects
 #ifdef ARDUINO_ARCH_ESP32
   ESP32I2SAudio *_audio;
+  WitAIMixerOutput *_mixerOut;
   BackgroundAudioMP3Class<RawDataBuffer<WITAI_BUFFER_SIZE>> *_mp3;
   HTTPClient _http;
-  uint8_t _networkBuffer[WITAI_NETWORK_BUFFER];
   WiFiClient *_stream;
   bool _isStreaming;
   bool _downloadCompleted;
 #elif defined(ARDUINO_ARCH_RP2040)
   I2SStream *_i2s;
+  WitAIMixerStream *_mixerStream;
   EncodedAudioStream *_decoder;
   MP3DecoderHelix *_mp3Decoder;
   bool _isPlaying;
+  bool _relayFormatPending;
+  size_t _relayProbeLen; // Relay payload collected in _networkBuffer
 #endif
 
+  // Mixer
+  WitAIMixer _mixer;
+
   // Network
   WiFiClientSecure _secureClient;
+  uint8_t _networkBuffer[WITAI_NETWORK_BUFFER];
+
+  // Relay (allocated by setRelayMode(), null while off)
+  WitAIRelay *_relay;
+  uint32_t _relayPlayAt;
+  bool _relayHold;
 
   // Pins
   uint8_t _bclkPin, _lrcPin, _dinPin;
@@ -176,9 +247,18 @@ private:
   float _gain;
   String _audioFormat;
   uint8_t _debugLevel;
+  uint32_t _outputRate;
+  uint8_t _outputChannels;
+  uint32_t _repeatWindowMs;
 
   // State
   bool _initialized;
+  WitAILoopStats _loopStats;
+  WitAIAudioFormat _reportedFormat;
+  WitAIRequestStats _requestStats;
+  bool _hasLastRequest;
+  uint32_t _lastRequestHash;
+  uint32_t _lastRequestMs;
 
   // Error callback
   void (*_errorCallback)(String);
@@ -187,15 +267,21 @@ private:
   void _initDefaults();
   String _buildSSML(String text);
   String _buildPayload(String text);
+  uint32_t _hashRequest(const String &payload);
   void _debugPrint(uint8_t level, String message);
   void _reportError(String error);
   bool _connectWiFi();
+  String _formatToString(WitAIAudioFormat format);
+  void _reportFormat();
+  void _serviceRelayPeer();
+  bool _isRelay(uint8_t mode);
 
 #ifdef ARDUINO_ARCH_ESP32
-  void _playWitTTS_ESP32(String text);
+  void _playWitTTS_ESP32(String text, String payload);
 #elif defined(ARDUINO_ARCH_RP2040)
-  bool _playWitTTS_Pico(String text);
+  bool _playWitTTS_Pico(String text, String payload);
   void _skipHeaders();
+  void _setStreamFormat(const uint8_t *data, size_t len);
 #endif
 };
 
@@ -0,0 +1,33 @@
+// Minimal check/runner shared by the host tests
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+struct HostTest {
+  const char *name;
+  void (*run)();
+};
+
+// Run every test, print one line each, return the process exit code
+template <size_t N> static int runTests(const HostTest (&tests)[N]) {
+  for (const HostTest &test : tests) {
+    int before = failures;
+    test.run();
+    printf("%s %s\n", failures == before ? "PASS" : "FAIL", test.name);
+  }
+  printf("%d failure(s)\n", failures);
+  return failures == 0 ? 0 : 1;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,36 @@
+// Minimal Arduino API for building library logic on the host
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+
+template <class T, class L, class H> T constrain(T x, L low, H high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+// Test clock, advanced by the test itself
+extern uint32_t hostMillis;
+inline uint32_t millis() { return hostMillis; }
+inline uint32_t micros() { return hostMillis * 1000; }
+
+class IPAddress {
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    _addr[0] = a;
+    _addr[1] = b;
+    _addr[2] = c;
+    _addr[3] = d;
+  }
+
+private:
+  uint8_t _addr[4];
+};
+
+#endif // HOST_ARDUINO_H
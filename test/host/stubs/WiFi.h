@@ -0,0 +1,12 @@
+// Host stand-in for the WiFi library, only what the relay touches
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+struct HostWiFi {
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+extern HostWiFi WiFi;
+
+#endif // HOST_WIFI_H
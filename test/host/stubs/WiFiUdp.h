@@ -0,0 +1,55 @@
+// Loopback WiFiUDP: every instance sends into and receives from one shared
+// queue, which tests reorder, duplicate or drop before peers read it
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+typedef std::vector<uint8_t> HostPacket;
+extern std::deque<HostPacket> hostNetwork;
+extern int hostUdpStops;
+
+class WiFiUDP {
+public:
+  bool beginMulticast(IPAddress, uint16_t) { return true; }
+  bool beginMulticast(IPAddress, IPAddress, uint16_t) { return true; }
+  int beginPacket(IPAddress, uint16_t) {
+    _out.clear();
+    return 1;
+  }
+  int beginPacketMulticast(IPAddress, uint16_t, IPAddress, int = 1) {
+    _out.clear();
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t len) {
+    _out.insert(_out.end(), data, data + len);
+    return len;
+  }
+  int endPacket() {
+    hostNetwork.push_back(_out);
+    return 1;
+  }
+
+  int parsePacket() {
+    if (hostNetwork.empty())
+      return 0;
+    _in = hostNetwork.front();
+    hostNetwork.pop_front();
+    return _in.size();
+  }
+  int read(uint8_t *buf, size_t len) {
+    size_t n = min(len, _in.size());
+    memcpy(buf, _in.data(), n);
+    _in.clear();
+    return n;
+  }
+  void stop() { hostUdpStops++; }
+
+private:
+  HostPacket _out;
+  HostPacket _in;
+};
+
+#endif // HOST_WIFIUDP_H
@@ -0,0 +1,179 @@
+// Host tests for WitAIMP3Header: the stream probe that sets the I2S format
+
+#include "WitAIMixer.h"
+#include "host_test.h"
+#include <vector>
+
+uint32_t hostMillis = 0;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// MPEG version bits as they sit in the header
+#define MPEG1 3
+#define MPEG2 2
+#define MPEG25 0
+
+// Append one Layer III frame of `length` bytes (header + zero payload)
+static void frame(std::vector<uint8_t> &s, uint8_t version, uint8_t bitrate,
+                  uint8_t rateIndex, uint8_t mode, size_t length,
+                  bool padding = false) {
+  size_t at = s.size();
+  s.resize(at + length + (padding ? 1 : 0), 0);
+  s[at] = 0xFF;
+  s[at + 1] = 0xE0 | (version << 3) | (1 << 1) | 1; // Layer III, no CRC
+  s[at + 2] = (bitrate << 4) | (rateIndex << 2) | (padding ? 2 : 0);
+  s[at + 3] = mode << 6;
+}
+
+static bool parse(const std::vector<uint8_t> &s, uint32_t &rate,
+                  uint8_t &channels) {
+  rate = 0;
+  channels = 0;
+  return WitAIMP3Header::parse(s.data(), s.size(), rate, channels);
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+static void testMpeg1() {
+  // 128 kbps 44.1 kHz joint stereo: 144 * 128000 / 44100 = 417 bytes
+  std::vector<uint8_t> s;
+  frame(s, MPEG1, 9, 0, 1, 417);
+  frame(s, MPEG1, 9, 0, 1, 417);
+  uint32_t rate;
+  uint8_t channels;
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 44100 && channels == 2);
+
+  // Padding adds one byte to the frame
+  s.clear();
+  frame(s, MPEG1, 9, 1, 0, 384, true); // 48 kHz: 144 * 128000 / 48000 = 384
+  frame(s, MPEG1, 9, 1, 0, 384);
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 48000 && channels == 2);
+}
+
+static void testMpeg2Mono() {
+  // 64 kbps 22050 Hz mono: 72 * 64000 / 22050 = 208 bytes
+  std::vector<uint8_t> s;
+  frame(s, MPEG2, 8, 0, 3, 208);
+  frame(s, MPEG2, 8, 0, 3, 208);
+  uint32_t rate;
+  uint8_t channels;
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 22050 && channels == 1);
+
+  // 32 kbps 24 kHz: 72 * 32000 / 24000 = 96 bytes
+  s.clear();
+  frame(s, MPEG2, 4, 1, 3, 96);
+  frame(s, MPEG2, 4, 1, 3, 96);
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 24000 && channels == 1);
+}
+
+static void testMpeg25() {
+  // 8 kbps 8 kHz: 72 * 8000 / 8000 = 72 bytes
+  std::vector<uint8_t> s;
+  frame(s, MPEG25, 1, 2, 3, 72);
+  frame(s, MPEG25, 1, 2, 3, 72);
+  uint32_t rate;
+  uint8_t channels;
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 8000 && channels == 1);
+
+  // 16 kbps 11025 Hz stereo: 72 * 16000 / 11025 = 104 bytes
+  s.clear();
+  frame(s, MPEG25, 2, 0, 0, 104);
+  frame(s, MPEG25, 2, 0, 0, 104);
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 11025 && channels == 2);
+}
+
+static void testId3Skip() {
+  // The tag holds a valid-looking 8 kHz frame pair that must be skipped
+  std::vector<uint8_t> s = {'I', 'D', '3', 4, 0, 0, 0, 0, 1, 32}; // 160 B
+  frame(s, MPEG25, 1, 2, 3, 72);
+  frame(s, MPEG25, 1, 2, 3, 72);
+  s.resize(10 + 160, 0);
+  frame(s, MPEG2, 8, 0, 3, 208);
+  frame(s, MPEG2, 8, 0, 3, 208);
+  uint32_t rate;
+  uint8_t channels;
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 22050 && channels == 1);
+}
+
+static void testFalseSync() {
+  // Chunked-encoding size line, then a lone 44.1 kHz stereo "header" in
+  // padding, then the real 22050 Hz mono stream
+  std::vector<uint8_t> s = {'1', 'f', '4', '\r', '\n'};
+  s.insert(s.end(), {0xFF, 0xFB, 0x90, 0x00, 0x00, 0x00});
+  frame(s, MPEG2, 8, 0, 3, 208);
+  frame(s, MPEG2, 8, 0, 3, 208);
+  uint32_t rate;
+  uint8_t channels;
+  CHECK(parse(s, rate, channels));
+  CHECK(rate == 22050 && channels == 1);
+
+  // A single frame can't be confirmed
+  s.clear();
+  frame(s, MPEG2, 8, 0, 3, 208);
+  CHECK(!parse(s, rate, channels));
+  CHECK(rate == 0);
+
+  // The next header disagrees on rate or mode
+  s.clear();
+  frame(s, MPEG2, 8, 0, 3, 208);
+  frame(s, MPEG2, 8, 1, 3, 192);
+  CHECK(!parse(s, rate, channels));
+  s.clear();
+  frame(s, MPEG2, 8, 0, 3, 208);
+  frame(s, MPEG2, 8, 0, 0, 208);
+  CHECK(!parse(s, rate, channels));
+}
+
+static void testRejected() {
+  uint32_t rate;
+  uint8_t channels;
+
+  // Free-format bitrate has no computable frame length
+  std::vector<uint8_t> s;
+  frame(s, MPEG1, 0, 0, 0, 417);
+  frame(s, MPEG1, 0, 0, 0, 417);
+  CHECK(!parse(s, rate, channels));
+
+  // Layer II is not what Wit.ai sends
+  s.clear();
+  frame(s, MPEG1, 9, 0, 0, 417);
+  frame(s, MPEG1, 9, 0, 0, 417);
+  s[1] = s[418] = 0xFD;
+  CHECK(!parse(s, rate, channels));
+
+  // Reserved version, reserved rate, too short
+  s.clear();
+  frame(s, MPEG1, 9, 3, 0, 417);
+  frame(s, MPEG1, 9, 3, 0, 417);
+  CHECK(!parse(s, rate, channels));
+  s.assign({0xFF, 0xEB, 0x90, 0x00});
+  CHECK(!parse(s, rate, channels));
+  CHECK(!WitAIMP3Header::parse(s.data(), 0, rate, channels));
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+  static const HostTest tests[] = {
+      {"MPEG-1", testMpeg1},
+      {"MPEG-2 mono", testMpeg2Mono},
+      {"MPEG-2.5", testMpeg25},
+      {"ID3 skip", testId3Skip},
+      {"false sync", testFalseSync},
+      {"rejected headers", testRejected},
+  };
+  return runTests(tests);
+}
@@ -0,0 +1,260 @@
+// Host tests for WitAIMixer and WitAIResampler: gain, saturation, format
+// conversion and the channel handoff between play()/stop() and mix()
+
+#include "WitAIMixer.h"
+#include "host_test.h"
+#include <vector>
+
+uint32_t hostMillis = 0;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static const int16_t constant[4] = {10000, 10000, 10000, 10000};
+static const int16_t loud[4] = {30000, 30000, 30000, 30000};
+static const int16_t stereo[4] = {1000, 3000, 1000, 3000}; // L, R, L, R
+
+// Counts calls so tests can tell which context pulled from a source
+static size_t sourceCalls = 0;
+
+static size_t rampSource(int16_t *buffer, size_t frames, void *context) {
+  int16_t *next = (int16_t *)context;
+  sourceCalls++;
+  for (size_t i = 0; i < frames; i++) {
+    buffer[i] = *next;
+    *next += 100;
+  }
+  return frames;
+}
+
+// ============================================================================
+// MIXER TESTS
+// ============================================================================
+
+static void testGain() {
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 2);
+  int ch = mixer.play(constant, 4, 16000, 1, 0.5f);
+  CHECK(ch >= 0);
+
+  int16_t out[8] = {0};
+  mixer.mix(out, 4);
+  for (int i = 0; i < 8; i++) {
+    CHECK(out[i] == 5000);
+  }
+
+  // Gain changes apply to the next mix
+  ch = mixer.play(constant, 4, 16000, 1, 1.0f);
+  mixer.setGain(ch, 0.25f);
+  int16_t quiet[2] = {0};
+  mixer.mix(quiet, 1);
+  CHECK(quiet[0] == 2500 && quiet[1] == 2500);
+}
+
+static void testSaturation() {
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  mixer.play(loud, 4, 16000);
+  mixer.play(loud, 4, 16000);
+
+  // Mixed onto existing speech, clipped rather than wrapped
+  int16_t out[4] = {10000, -10000, 0, 32767};
+  mixer.mix(out, 4);
+  CHECK(out[0] == 32767);
+  CHECK(out[1] == 32767);
+  CHECK(out[2] == 32767);
+  CHECK(out[3] == 32767);
+
+  static const int16_t negative[2] = {-30000, -30000};
+  mixer.play(negative, 2, 16000);
+  mixer.play(negative, 2, 16000);
+  int16_t low[2] = {-10000, 0};
+  mixer.mix(low, 2);
+  CHECK(low[0] == -32768 && low[1] == -32768);
+}
+
+static void testChannelConversion() {
+  // Stereo clip downmixed to mono output
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  mixer.play(stereo, 2, 16000, 2);
+  int16_t mono[2] = {0};
+  mixer.mix(mono, 2);
+  CHECK(mono[0] == 2000 && mono[1] == 2000);
+
+  // Mono clip duplicated to both output channels
+  mixer.setOutputFormat(16000, 2);
+  mixer.play(constant, 1, 16000, 1);
+  int16_t out[2] = {0};
+  mixer.mix(out, 1);
+  CHECK(out[0] == 10000 && out[1] == 10000);
+}
+
+static void testResampling() {
+  // 8 kHz ramp into a 16 kHz mix: inputs interleaved with midpoints
+  static const int16_t ramp[4] = {0, 100, 200, 300};
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  mixer.play(ramp, 4, 8000);
+
+  int16_t out[10] = {0};
+  mixer.mix(out, 10);
+  static const int16_t expected[10] = {0, 50, 100, 150, 200, 250, 300, 300};
+  for (int i = 0; i < 10; i++) {
+    CHECK(out[i] == expected[i]); // Last input held for one input period
+  }
+  CHECK(!mixer.isActive());
+}
+
+static void testClipEnd() {
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  int ch = mixer.play(constant, 4, 16000);
+  CHECK(mixer.isActive(ch));
+
+  // Frames after the clip are left as they were
+  int16_t out[6] = {1, 1, 1, 1, 1, 1};
+  mixer.mix(out, 6);
+  CHECK(out[0] == 10001 && out[3] == 10001);
+  CHECK(out[4] == 1 && out[5] == 1);
+  CHECK(!mixer.isActive(ch));
+  CHECK(!mixer.isActive());
+}
+
+static void testStopHandoff() {
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  for (int i = 0; i < WITAI_MIXER_CHANNELS; i++) {
+    CHECK(mixer.play(constant, 4, 16000) == i);
+  }
+  CHECK(mixer.play(constant, 4, 16000) < 0); // All busy
+
+  // STOPPING: no longer playing, but not reusable until mix() releases it
+  mixer.stop(1);
+  CHECK(!mixer.isActive(1));
+  CHECK(mixer.isActive());
+  CHECK(mixer.play(constant, 4, 16000) < 0);
+
+  // mix() skips it and hands it back
+  int16_t out[1] = {0};
+  mixer.mix(out, 1);
+  CHECK(out[0] == 10000 * (WITAI_MIXER_CHANNELS - 1));
+  CHECK(mixer.play(constant, 4, 16000) == 1);
+
+  // stopAll() releases everything on the next mix
+  mixer.stopAll();
+  out[0] = 0;
+  mixer.mix(out, 1);
+  CHECK(out[0] == 0);
+  CHECK(!mixer.isActive());
+}
+
+static void testSourceContext() {
+  WitAIMixer mixer;
+  mixer.setOutputFormat(16000, 1);
+  int16_t next = 0;
+  sourceCalls = 0;
+  int ch = mixer.play(rampSource, &next, 16000);
+  CHECK(ch >= 0);
+  CHECK(sourceCalls == 0); // Only mix() pulls from a source
+
+  int16_t out[WITAI_MIXER_SOURCE_FRAMES + 2] = {0};
+  mixer.mix(out, WITAI_MIXER_SOURCE_FRAMES + 2);
+  CHECK(sourceCalls == 2);
+  CHECK(out[0] == 0 && out[1] == 100);
+  CHECK(out[WITAI_MIXER_SOURCE_FRAMES + 1] ==
+        100 * (WITAI_MIXER_SOURCE_FRAMES + 1));
+  mixer.stop(ch);
+}
+
+// ============================================================================
+// RESAMPLER TESTS
+// ============================================================================
+
+static void testResamplerPassthrough() {
+  WitAIResampler resampler;
+  resampler.setFormat(22050, 1, 22050, 1);
+  CHECK(resampler.isPassthrough());
+  resampler.setFormat(22050, 1, 44100, 2);
+  CHECK(!resampler.isPassthrough());
+}
+
+static void testResamplerUpsample() {
+  // 22050 mono to 44100 stereo, fed in small pieces to check state carries
+  WitAIResampler resampler;
+  resampler.setFormat(22050, 1, 44100, 2);
+  static const int16_t in[6] = {0, 200, 400, 600, 800, 1000};
+  std::vector<int16_t> out;
+  for (size_t i = 0; i < 6; i += 2) {
+    int16_t buf[16];
+    size_t consumed;
+    size_t produced = resampler.process(in + i, 2, consumed, buf, 8);
+    CHECK(consumed == 2);
+    out.insert(out.end(), buf, buf + produced * 2);
+  }
+
+  // Output lags one input frame behind, so five input steps come out
+  CHECK(out.size() == 20);
+  for (size_t f = 0; f < out.size() / 2; f++) {
+    CHECK(out[f * 2] == (int16_t)(f * 100));
+    CHECK(out[f * 2] == out[f * 2 + 1]);
+  }
+}
+
+static void testResamplerDownsample() {
+  // 48000 stereo to 16000 mono: every third frame, L/R averaged
+  WitAIResampler resampler;
+  resampler.setFormat(48000, 2, 16000, 1);
+  int16_t in[18 * 2];
+  for (int i = 0; i < 18; i++) {
+    in[i * 2] = i * 30;
+    in[i * 2 + 1] = i * 30 + 60;
+  }
+  int16_t out[8];
+  size_t consumed;
+  size_t produced = resampler.process(in, 18, consumed, out, 8);
+  CHECK(consumed == 18);
+  CHECK(produced == 6);
+  for (size_t i = 0; i < produced; i++) {
+    CHECK(out[i] == (int16_t)(i * 90 + 30));
+  }
+}
+
+static void testResamplerOutputLimit() {
+  // A full output buffer stops early without consuming more input
+  WitAIResampler resampler;
+  resampler.setFormat(8000, 1, 16000, 1);
+  static const int16_t in[8] = {0, 10, 20, 30, 40, 50, 60, 70};
+  int16_t out[4];
+  size_t consumed;
+  CHECK(resampler.process(in, 8, consumed, out, 4) == 4);
+  CHECK(consumed == 3);
+  CHECK(out[0] == 0 && out[1] == 5 && out[2] == 10 && out[3] == 15);
+
+  size_t more =
+      resampler.process(in + consumed, 8 - consumed, consumed, out, 4);
+  CHECK(more == 4);
+  CHECK(out[0] == 20);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+  static const HostTest tests[] = {
+      {"gain", testGain},
+      {"saturation", testSaturation},
+      {"channel conversion", testChannelConversion},
+      {"resampling", testResampling},
+      {"clip end", testClipEnd},
+      {"stop handoff", testStopHandoff},
+      {"source context", testSourceContext},
+      {"resampler passthrough", testResamplerPassthrough},
+      {"resampler upsample", testResamplerUpsample},
+      {"resampler downsample", testResamplerDownsample},
+      {"resampler output limit", testResamplerOutputLimit},
+  };
+  return runTests(tests);
+}
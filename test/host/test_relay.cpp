@@ -0,0 +1,425 @@
+// Host tests for WitAIRelay: wire format, reorder/jitter buffer and session
+// handling, run over the loopback WiFiUDP in stubs/
+
+#include "WitAIRelay.h"
+#include "host_test.h"
+
+uint32_t hostMillis = 1000;
+HostWiFi WiFi;
+std::deque<HostPacket> hostNetwork;
+int hostUdpStops = 0;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// Build a packet by the wire spec, independently of _writeHeader()
+static HostPacket packet(uint8_t type, uint16_t session, uint16_t seq,
+                         uint32_t playAtMs, uint16_t tag = 0) {
+  HostPacket p(WITAI_RELAY_HEADER_SIZE);
+  uint32_t senderMs = hostMillis;
+  p[0] = 'W';
+  p[1] = 'T';
+  p[2] = 1;
+  p[3] = type;
+  p[4] = session & 0xFF;
+  p[5] = session >> 8;
+  p[6] = seq & 0xFF;
+  p[7] = seq >> 8;
+  for (int i = 0; i < 4; i++) {
+    p[8 + i] = (senderMs >> (8 * i)) & 0xFF;
+    p[12 + i] = (playAtMs >> (8 * i)) & 0xFF;
+  }
+  if (type == 1) {
+    p[16] = 2;
+    p.push_back(tag & 0xFF);
+    p.push_back(tag >> 8);
+  }
+  return p;
+}
+
+static HostPacket start(uint16_t session) {
+  return packet(0, session, 0, hostMillis + WITAI_RELAY_PLAY_DELAY_MS);
+}
+
+static HostPacket data(uint16_t session, uint16_t seq) {
+  return packet(1, session, seq, hostMillis + WITAI_RELAY_PLAY_DELAY_MS, seq);
+}
+
+static HostPacket end(uint16_t session, uint16_t seq) {
+  return packet(2, session, seq, hostMillis + WITAI_RELAY_PLAY_DELAY_MS);
+}
+
+static HostPacket abortPacket(uint16_t session, uint16_t seq) {
+  return packet(3, session, seq, hostMillis + WITAI_RELAY_PLAY_DELAY_MS);
+}
+
+// Drain everything deliverable now, returning the tags in delivery order
+static std::vector<uint16_t> drain(WitAIRelay &peer) {
+  std::vector<uint16_t> tags;
+  size_t len;
+  const uint8_t *buf;
+  while ((buf = peer.peek(len)) != nullptr) {
+    tags.push_back(len == 2 ? (uint16_t)(buf[0] | (buf[1] << 8)) : 0xFFFF);
+    peer.consume();
+  }
+  return tags;
+}
+
+static std::vector<uint16_t> seqs(std::initializer_list<uint16_t> list) {
+  return std::vector<uint16_t>(list);
+}
+
+static void newPeer(WitAIRelay &peer) {
+  hostNetwork.clear();
+  peer.begin(WITAI_RELAY_PEER, WITAI_RELAY_GROUP);
+  peer.resetStats();
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+static void testHeaderCodec() {
+  WitAIRelay leader;
+  hostNetwork.clear();
+  CHECK(leader.begin(WITAI_RELAY_LEADER, WITAI_RELAY_GROUP));
+
+  uint8_t payload[3] = {0xAA, 0xBB, 0xCC};
+  leader.startSession(0x12345678);
+  leader.send(payload, sizeof(payload));
+  leader.endSession();
+  CHECK(hostNetwork.size() == 3);
+  CHECK(leader.getStats().sent == 3);
+
+  const HostPacket &p = hostNetwork[1];
+  CHECK(p.size() == WITAI_RELAY_HEADER_SIZE + 3);
+  CHECK(p[0] == 'W' && p[1] == 'T' && p[2] == 1);
+  CHECK(p[3] == 1); // DATA
+  CHECK(p[4] == hostNetwork[0][4] && p[5] == hostNetwork[0][5]);
+  CHECK(p[6] == 1 && p[7] == 0); // seq 1, START was 0
+  CHECK(p[12] == 0x78 && p[13] == 0x56 && p[14] == 0x34 && p[15] == 0x12);
+  CHECK(p[16] == 3 && p[17] == 0);
+  CHECK(p[18] == 0xAA && p[20] == 0xCC);
+  CHECK(hostNetwork[2][3] == 2); // END
+
+  // Payloads larger than one packet are split
+  hostNetwork.clear();
+  uint8_t big[WITAI_RELAY_PAYLOAD + 10] = {0};
+  leader.startSession(0);
+  leader.send(big, sizeof(big));
+  CHECK(hostNetwork.size() == 3);
+  CHECK(hostNetwork[2].size() == WITAI_RELAY_HEADER_SIZE + 10);
+
+  // Leader to peer over loopback
+  WitAIRelay peer;
+  peer.begin(WITAI_RELAY_PEER, WITAI_RELAY_GROUP);
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_START);
+  size_t len;
+  CHECK(peer.peek(len) != nullptr && len == WITAI_RELAY_PAYLOAD);
+
+  // Truncated or foreign packets are ignored
+  hostNetwork.clear();
+  HostPacket bad = data(7, 1);
+  bad.pop_back();
+  hostNetwork.push_back(bad);
+  HostPacket foreign = data(7, 1);
+  foreign[0] = 'X';
+  hostNetwork.push_back(foreign);
+  peer.resetStats();
+  peer.poll();
+  CHECK(peer.getStats().received == 0);
+}
+
+static void testLeaderEndClosesSocket() {
+  WitAIRelay leader;
+  leader.begin(WITAI_RELAY_LEADER, WITAI_RELAY_GROUP);
+  leader.startSession(0);
+  int stops = hostUdpStops;
+  leader.end();
+  CHECK(hostUdpStops == stops + 1);
+  CHECK(leader.getMode() == WITAI_RELAY_OFF);
+  CHECK(hostNetwork.back()[3] == 2); // Session ended before closing
+  hostNetwork.clear();
+}
+
+static void testReorderAndDuplicates() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  hostNetwork.push_back(start(1));
+  hostNetwork.push_back(data(1, 1));
+  hostNetwork.push_back(data(1, 3));
+  hostNetwork.push_back(data(1, 2));
+  hostNetwork.push_back(data(1, 2)); // Duplicate while buffered
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_START);
+  CHECK(peer.isActive());
+  CHECK(drain(peer) == seqs({1, 2, 3}));
+
+  hostNetwork.push_back(data(1, 2)); // Duplicate after delivery
+  hostNetwork.push_back(end(1, 4));
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_END);
+  CHECK(drain(peer).empty());
+  peer.poll();
+  CHECK(!peer.isActive());
+
+  WitAIRelayStats stats = peer.getStats();
+  CHECK(stats.delivered == 3);
+  CHECK(stats.reordered == 1);
+  CHECK(stats.duplicates == 2);
+  CHECK(stats.lost == 0);
+}
+
+static void testGapTimeout() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  hostNetwork.push_back(start(2));
+  hostNetwork.push_back(data(2, 1));
+  hostNetwork.push_back(data(2, 3)); // 2 never arrives
+  peer.poll();
+  CHECK(drain(peer) == seqs({1}));
+
+  // Waits for the missing packet, then skips it
+  hostMillis += WITAI_RELAY_GAP_MS / 2;
+  CHECK(drain(peer).empty());
+  hostMillis += WITAI_RELAY_GAP_MS;
+  CHECK(drain(peer) == seqs({3}));
+
+  // Late arrival of the skipped packet is not replayed
+  hostNetwork.push_back(data(2, 2));
+  peer.poll();
+  CHECK(drain(peer).empty());
+
+  WitAIRelayStats stats = peer.getStats();
+  CHECK(stats.lost == 1);
+  CHECK(stats.duplicates == 1);
+}
+
+static void testSequenceWrap() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  hostNetwork.push_back(start(3));
+  for (uint32_t seq = 1; seq <= 65533; seq++) {
+    hostNetwork.push_back(data(3, seq));
+    peer.poll();
+    drain(peer);
+  }
+  CHECK(peer.getStats().delivered == 65533);
+
+  // Reordered across the wrap: 0 before 65535 before 65534
+  hostNetwork.push_back(data(3, 0));
+  hostNetwork.push_back(data(3, 65535));
+  hostNetwork.push_back(data(3, 65534));
+  hostNetwork.push_back(data(3, 1));
+  peer.poll();
+  CHECK(drain(peer) == seqs({65534, 65535, 0, 1}));
+
+  // Pre-wrap stragglers are duplicates, not far-future packets
+  hostNetwork.push_back(data(3, 65535));
+  peer.poll();
+  CHECK(drain(peer).empty());
+
+  WitAIRelayStats stats = peer.getStats();
+  CHECK(stats.lost == 0);
+  CHECK(stats.overflow == 0);
+  CHECK(stats.duplicates == 1);
+}
+
+static void testOverflow() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  // One packet more than the jitter buffer holds, none drained
+  hostNetwork.push_back(start(4));
+  peer.poll();
+  for (uint16_t seq = 1; seq <= WITAI_RELAY_SLOTS + 1; seq++) {
+    hostNetwork.push_back(data(4, seq));
+    peer.poll();
+  }
+  CHECK(peer.pending() == WITAI_RELAY_SLOTS);
+  CHECK(drain(peer).front() == 2);
+
+  WitAIRelayStats stats = peer.getStats();
+  CHECK(stats.overflow == 1);
+  CHECK(stats.lost == 0);
+}
+
+static void testSessionChange() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  hostNetwork.push_back(start(5));
+  hostNetwork.push_back(data(5, 1));
+  hostNetwork.push_back(data(5, 3));
+  peer.poll();
+
+  // A new utterance replaces the old one, buffered packets included
+  hostNetwork.push_back(start(6));
+  hostNetwork.push_back(data(6, 1));
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_START);
+  CHECK(drain(peer) == seqs({1}));
+  CHECK(peer.pending() == 0);
+
+  // Data can overtake START, the session still begins at seq 1
+  hostNetwork.push_back(data(7, 2));
+  hostNetwork.push_back(data(7, 1));
+  hostNetwork.push_back(start(7));
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_START);
+  CHECK(drain(peer) == seqs({1, 2}));
+
+  // Packets from an older session are dropped
+  peer.resetStats();
+  hostNetwork.push_back(end(7, 3));
+  peer.poll();
+  peer.poll();
+  CHECK(!peer.isActive());
+  hostNetwork.push_back(data(7, 4));
+  CHECK(peer.poll() == 0);
+  CHECK(peer.getStats().duplicates == 1);
+
+  // Play-at maps the leader's clock to the local one
+  newPeer(peer);
+  uint32_t leaderNow = 50000;
+  uint32_t playAt = leaderNow + WITAI_RELAY_PLAY_DELAY_MS;
+  uint32_t local = hostMillis;
+  hostMillis = leaderNow;
+  HostPacket p = packet(0, 8, 0, playAt);
+  hostMillis = local;
+  hostNetwork.push_back(p);
+  peer.poll();
+  CHECK(peer.playAt() == local + WITAI_RELAY_PLAY_DELAY_MS);
+}
+
+static void testAbortAndTimeout() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  hostNetwork.push_back(start(9));
+  hostNetwork.push_back(data(9, 1));
+  hostNetwork.push_back(data(9, 2));
+  peer.poll();
+  peer.abort();
+  CHECK(!peer.isActive());
+  CHECK(peer.pending() == 0);
+
+  // The rest of the aborted session is ignored
+  hostNetwork.push_back(data(9, 3));
+  hostNetwork.push_back(end(9, 4));
+  CHECK(peer.poll() == 0);
+  CHECK(!peer.isActive());
+  CHECK(drain(peer).empty());
+
+  // The next session plays normally
+  hostNetwork.push_back(start(10));
+  hostNetwork.push_back(data(10, 1));
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_START);
+  CHECK(drain(peer) == seqs({1}));
+
+  // A leader that goes quiet ends the session
+  hostMillis += WITAI_RELAY_TIMEOUT_MS + 1;
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_END);
+  CHECK(!peer.isActive());
+}
+
+static void testLateFromPreviousSession() {
+  WitAIRelay peer;
+  newPeer(peer);
+
+  // The leader cut A short: END(A) is overtaken by B's packets
+  hostNetwork.push_back(start(11));
+  hostNetwork.push_back(data(11, 1));
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_START);
+  hostNetwork.push_back(start(12));
+  hostNetwork.push_back(data(12, 1));
+  hostNetwork.push_back(data(12, 2));
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_START);
+  hostNetwork.push_back(end(11, 2));
+  hostNetwork.push_back(data(11, 2));
+  hostNetwork.push_back(start(11));
+  CHECK(peer.poll() == 0); // No restart, no end
+  CHECK(peer.isActive());
+
+  // B carries on unharmed
+  hostNetwork.push_back(data(12, 3));
+  CHECK(peer.poll() == 0);
+  CHECK(drain(peer) == seqs({1, 2, 3}));
+  CHECK(peer.getStats().duplicates == 3);
+
+  // A replaced session stays replaced after the next one ends too
+  hostNetwork.push_back(end(12, 4));
+  peer.poll();
+  peer.poll();
+  CHECK(!peer.isActive());
+  hostNetwork.push_back(data(11, 3));
+  CHECK(peer.poll() == 0);
+  CHECK(!peer.isActive());
+}
+
+static void testLeaderAbort() {
+  WitAIRelay leader;
+  WitAIRelay peer;
+  newPeer(peer);
+  leader.begin(WITAI_RELAY_LEADER, WITAI_RELAY_GROUP);
+
+  uint8_t payload[4] = {1, 2, 3, 4};
+  leader.startSession(hostMillis + WITAI_RELAY_PLAY_DELAY_MS);
+  leader.send(payload, sizeof(payload));
+  leader.send(payload, sizeof(payload));
+  CHECK(peer.poll() & WITAI_RELAY_EVENT_START);
+  CHECK(peer.pending() == 2);
+
+  // stop() on the leader: peers drop what they hold, not play it out
+  leader.abort();
+  CHECK(!leader.isActive());
+  CHECK(hostNetwork.back()[3] == 3); // ABORT
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_ABORT);
+  CHECK(!peer.isActive());
+  CHECK(peer.pending() == 0);
+  CHECK(drain(peer).empty());
+
+  // Packets of the aborted session still in flight are ignored
+  hostNetwork.push_back(data(13, 1));
+  peer.poll();
+  hostNetwork.push_back(abortPacket(13, 2));
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_ABORT);
+  hostNetwork.push_back(data(13, 3));
+  hostNetwork.push_back(end(13, 4));
+  CHECK(peer.poll() == 0);
+  CHECK(!peer.isActive());
+
+  // ABORT overtaking START still keeps the session from starting
+  hostNetwork.push_back(abortPacket(14, 3));
+  CHECK(peer.poll() == WITAI_RELAY_EVENT_ABORT);
+  hostNetwork.push_back(start(14));
+  hostNetwork.push_back(data(14, 1));
+  CHECK(peer.poll() == 0);
+  CHECK(!peer.isActive());
+
+  // A second abort does nothing
+  leader.abort();
+  CHECK(hostNetwork.empty());
+  leader.end();
+  hostNetwork.clear();
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+  static const HostTest tests[] = {
+      {"header codec", testHeaderCodec},
+      {"leader end", testLeaderEndClosesSocket},
+      {"reorder and duplicates", testReorderAndDuplicates},
+      {"gap timeout", testGapTimeout},
+      {"sequence wrap", testSequenceWrap},
+      {"overflow", testOverflow},
+      {"session change", testSessionChange},
+      {"abort and timeout", testAbortAndTimeout},
+      {"late packets from previous session", testLateFromPreviousSession},
+      {"leader abort", testLeaderAbort},
+  };
+  return runTests(tests);
+}